@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <print>
+#include <string_view>
+#include <vector>
+
+#include <box2d/box2d.h>
+
+#include "Physics/StressScenes.h"
+#include "Physics/TaskScheduler.h"
+#include "Util/Statistics.h"
+
+namespace
+{
+    /// Steps run before timing, so one-off allocations in the first steps are not measured
+    constexpr int WARMUP_STEPS = 10;
+
+    constexpr float TIMESTEP = 1.0f / 60.0f;
+    constexpr int SUB_STEPS = 4;
+
+    constexpr std::array<int, 3> DEFAULT_SIZES = {1000, 10000, 100000};
+
+    struct Options
+    {
+        int steps = 300;
+        int worker_count = TaskScheduler::max_worker_count();
+        std::uint32_t seed = 1;
+        std::vector<int> sizes{DEFAULT_SIZES.begin(), DEFAULT_SIZES.end()};
+
+        /// Only run the scene with this name, or every scene if empty
+        std::string_view scene;
+    };
+
+    template <typename T>
+    bool parse_value(std::string_view text, T& value)
+    {
+        auto end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, value);
+        return ec == std::errc{} && ptr == end && value >= 0;
+    }
+
+    /// Parses a comma separated list of sizes, e.g. "1000,10000"
+    bool parse_sizes(std::string_view text, std::vector<int>& sizes)
+    {
+        sizes.clear();
+        while (!text.empty())
+        {
+            auto comma = text.find(',');
+            int size = 0;
+            if (!parse_value(text.substr(0, comma), size))
+            {
+                return false;
+            }
+            sizes.push_back(size);
+            text = comma == std::string_view::npos ? "" : text.substr(comma + 1);
+        }
+        return !sizes.empty();
+    }
+
+    bool parse_options(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            std::string_view arg = argv[i];
+            std::string_view value = argv[i + 1];
+
+            bool valid = false;
+            if (arg == "--steps")
+            {
+                valid = parse_value(value, options.steps) && options.steps > 0;
+            }
+            else if (arg == "--workers")
+            {
+                valid = parse_value(value, options.worker_count) && options.worker_count > 0;
+            }
+            else if (arg == "--seed")
+            {
+                valid = parse_value(value, options.seed);
+            }
+            else if (arg == "--sizes")
+            {
+                valid = parse_sizes(value, options.sizes);
+            }
+            else if (arg == "--scene")
+            {
+                options.scene = value;
+                valid = true;
+            }
+
+            if (!valid)
+            {
+                std::println(std::cerr, "Invalid option '{} {}'.", arg, value);
+                return false;
+            }
+        }
+        if (argc % 2 == 0)
+        {
+            std::println(std::cerr, "Missing value for '{}'.", argv[argc - 1]);
+            return false;
+        }
+        return true;
+    }
+
+    struct SceneRun
+    {
+        /// The bodies the scene was built with, which can differ from the size asked for
+        int body_count = 0;
+
+        /// The time of each timed step in milliseconds
+        std::vector<double> step_times;
+    };
+
+    SceneRun run_scene(StressScene scene, int size, const Options& options,
+                       TaskScheduler& scheduler)
+    {
+        b2WorldDef world_def = b2DefaultWorldDef();
+        world_def.gravity = {0.0f, -10.0f};
+        scheduler.configure(world_def);
+        auto world = b2CreateWorld(&world_def);
+
+        SceneRun run;
+        Random rng(options.seed);
+        run.body_count = build_stress_scene(scene, world, size, rng);
+
+        for (int i = 0; i < WARMUP_STEPS; i++)
+        {
+            b2World_Step(world, TIMESTEP, SUB_STEPS);
+        }
+
+        run.step_times.reserve(options.steps);
+        for (int i = 0; i < options.steps; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            b2World_Step(world, TIMESTEP, SUB_STEPS);
+            std::chrono::duration<double, std::milli> time =
+                std::chrono::steady_clock::now() - start;
+            run.step_times.push_back(time.count());
+        }
+
+        b2DestroyWorld(world);
+        return run;
+    }
+} // namespace
+
+/// Times each stress scene at each size and prints the results as CSV, one row per run.
+///
+/// Usage: physics-benchmark [--steps n] [--workers n] [--seed n] [--sizes n,n,...] [--scene name]
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parse_options(argc, argv, options))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!options.scene.empty() &&
+        std::ranges::none_of(STRESS_SCENES, [&](StressScene scene)
+                             { return to_string(scene) == options.scene; }))
+    {
+        std::println(std::cerr, "Unknown scene '{}'. The scenes are:", options.scene);
+        for (auto scene : STRESS_SCENES)
+        {
+            std::println(std::cerr, "    {}", to_string(scene));
+        }
+        return EXIT_FAILURE;
+    }
+
+    TaskScheduler scheduler(options.worker_count);
+
+    std::println("scene,bodies,steps,workers,mean_ms,p50_ms,p99_ms,max_ms,bodies_per_second");
+    for (auto scene : STRESS_SCENES)
+    {
+        if (!options.scene.empty() && options.scene != to_string(scene))
+        {
+            continue;
+        }
+
+        for (auto size : options.sizes)
+        {
+            // Progress goes to stderr so stdout is only the results
+            std::println(std::cerr, "Running {} with {} bodies...", to_string(scene), size);
+
+            auto run = run_scene(scene, size, options, scheduler);
+            auto statistics = calculate_statistics(run.step_times);
+            auto bodies_per_second =
+                static_cast<double>(run.body_count) / (statistics.mean / 1000.0);
+
+            std::println("{},{},{},{},{:.4f},{:.4f},{:.4f},{:.4f},{:.0f}", to_string(scene),
+                         run.body_count, options.steps, scheduler.worker_count(),
+                         statistics.mean, statistics.p50, statistics.p99, statistics.max,
+                         bodies_per_second);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Util/MappedFile.h"
+#include "Util/Random.h"
+#include "Util/TextScanner.h"
+
+namespace
+{
+    constexpr int RUNS = 5;
+
+    /// Writes a text scene of boxes with random positions and angles, with a hull every 100 lines
+    void write_scene(const std::filesystem::path& path, int body_count)
+    {
+        Random rng(1);
+        std::ofstream file(path);
+        file << "# Generated by scene-parsing\ngravity 0 -20\n";
+        for (int i = 0; i < body_count; i++)
+        {
+            if (i % 100 == 0)
+            {
+                std::println(file, "hull {:.3f} {:.3f} -5 0 5 0 0 5", rng.range(0.0f, 1000.0f),
+                             rng.range(0.0f, 1000.0f));
+            }
+            else
+            {
+                std::println(file, "box {:.3f} {:.3f} {:.1f}", rng.range(0.0f, 1000.0f),
+                             rng.range(0.0f, 1000.0f), rng.range(0.0f, 360.0f));
+            }
+        }
+    }
+
+    // The file utilities Util.cpp had before the scene files: a copy of the file, then a string
+    // per token through a std::stringstream
+    std::string read_file_to_string(const std::filesystem::path& file_path)
+    {
+        std::ifstream in_file(file_path);
+        return {std::istreambuf_iterator<char>(in_file), std::istreambuf_iterator<char>()};
+    }
+
+    std::vector<std::string> split_string(const std::string& string, char delim)
+    {
+        std::vector<std::string> tokens;
+        std::stringstream stream(string);
+        std::string token;
+        while (std::getline(stream, token, delim))
+        {
+            tokens.push_back(token);
+        }
+        return tokens;
+    }
+
+    /// Parses every number of the scene with the old utilities and std::stof
+    /// @return The sum of the numbers, so the parsing is not optimised away
+    double parse_with_strings(const std::filesystem::path& path)
+    {
+        double sum = 0;
+        for (auto& line : split_string(read_file_to_string(path), '\n'))
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+
+            auto tokens = split_string(line, ' ');
+            for (std::size_t i = 1; i < tokens.size(); i++)
+            {
+                sum += std::stof(tokens[i]);
+            }
+        }
+        return sum;
+    }
+
+    /// Parses every number of the scene in place from the mapped file
+    double parse_with_scanner(const std::filesystem::path& path)
+    {
+        MappedFile file;
+        if (!file.open(path.string()))
+        {
+            return 0;
+        }
+
+        double sum = 0;
+        auto bytes = file.bytes();
+        TextScanner scanner({reinterpret_cast<const char*>(bytes.data()), bytes.size()});
+        while (scanner.next_line())
+        {
+            scanner.next_token();
+            float value;
+            while (scanner.next_number(value))
+            {
+                sum += value;
+            }
+        }
+        return sum;
+    }
+
+    /// Times the parser over several runs
+    /// @return The fastest run in milliseconds
+    template <typename Parse>
+    double time_parse(Parse parse, const std::filesystem::path& path, double& sum)
+    {
+        auto best = std::chrono::duration<double, std::milli>::max();
+        for (int i = 0; i < RUNS; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            sum = parse(path);
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                                      std::chrono::steady_clock::now() - start));
+        }
+        return best.count();
+    }
+} // namespace
+
+/// Compares parsing a text scene with the old file and string utilities against the mapped file
+/// and TextScanner, on a generated scene. Only the tokenizing and number parsing is timed, not
+/// building the records or the bodies.
+///
+/// Usage: scene-parsing [bodies]
+int main(int argc, char** argv)
+{
+    int body_count = 1'000'000;
+    if (argc > 1)
+    {
+        std::string_view text = argv[1];
+        auto end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, body_count);
+        if (ec != std::errc{} || ptr != end || body_count <= 0)
+        {
+            std::println(std::cerr, "Invalid body count '{}', expected a positive number.", text);
+            return EXIT_FAILURE;
+        }
+    }
+    auto path = std::filesystem::temp_directory_path() / "scene-parsing.txt";
+    write_scene(path, body_count);
+    auto megabytes = static_cast<double>(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+    std::println("{} bodies, {:.1f}MB, fastest of {} runs", body_count, megabytes, RUNS);
+
+    double strings_sum = 0;
+    double scanner_sum = 0;
+    auto strings_time = time_parse(parse_with_strings, path, strings_sum);
+    auto scanner_time = time_parse(parse_with_scanner, path, scanner_sum);
+    std::println("read_file_to_string + split_string: {:8.1f}ms {:7.1f}MB/s", strings_time,
+                 megabytes / (strings_time / 1000.0));
+    std::println("MappedFile + TextScanner:           {:8.1f}ms {:7.1f}MB/s", scanner_time,
+                 megabytes / (scanner_time / 1000.0));
+    std::println("Speedup: {:.1f}x", strings_time / scanner_time);
+
+    if (std::abs(strings_sum - scanner_sum) > std::abs(strings_sum) * 1e-6)
+    {
+        std::println(std::cerr, "The parsers disagree: {} and {}", strings_sum, scanner_sum);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,114 @@
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <print>
+#include <string_view>
+
+#include <box2d/box2d.h>
+
+#include "Physics/TaskScheduler.h"
+
+namespace
+{
+    /// Steps run before timing, so the pile has settled into contact
+    constexpr int WARMUP_STEPS = 60;
+
+    constexpr float TIMESTEP = 1.0f / 60.0f;
+    constexpr int SUB_STEPS = 4;
+
+    /// Builds a ground with columns of stacked boxes on it
+    b2WorldId create_pile(TaskScheduler& scheduler, int columns, int rows)
+    {
+        b2WorldDef world_def = b2DefaultWorldDef();
+        world_def.gravity = {0, -10.0f};
+        scheduler.configure(world_def);
+        auto world = b2CreateWorld(&world_def);
+
+        b2BodyDef ground_def = b2DefaultBodyDef();
+        auto ground = b2CreateBody(world, &ground_def);
+        b2ShapeDef ground_shape = b2DefaultShapeDef();
+        b2Polygon ground_box = b2MakeOffsetBox(columns * 1.5f, 1.0f, {0, -1.0f}, b2Rot_identity);
+        b2CreatePolygonShape(ground, &ground_shape, &ground_box);
+
+        b2ShapeDef shape = b2DefaultShapeDef();
+        shape.density = 1.0f;
+        shape.material.friction = 0.6f;
+        b2Polygon box = b2MakeBox(0.5f, 0.5f);
+        for (int x = 0; x < columns; x++)
+        {
+            for (int y = 0; y < rows; y++)
+            {
+                b2BodyDef body = b2DefaultBodyDef();
+                body.type = b2_dynamicBody;
+                body.position = {(x - columns / 2) * 1.5f, 0.5f + y * 1.0f};
+                b2CreatePolygonShape(b2CreateBody(world, &body), &shape, &box);
+            }
+        }
+        return world;
+    }
+
+    /// Leaves the value as it is if the argument was not given
+    bool parse_arg(int argc, char** argv, int index, int& value)
+    {
+        if (argc <= index)
+        {
+            return true;
+        }
+
+        std::string_view text = argv[index];
+        auto end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, value);
+        if (ec != std::errc{} || ptr != end || value <= 0)
+        {
+            std::println(std::cerr, "Invalid argument '{}', expected a positive number.", text);
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+/// Measures how the step time of a large pile of boxes scales from 1 worker up to every core.
+///
+/// Usage: worker-scaling [columns] [rows] [steps]
+int main(int argc, char** argv)
+{
+    int columns = 100;
+    int rows = 40;
+    int steps = 300;
+    if (!parse_arg(argc, argv, 1, columns) || !parse_arg(argc, argv, 2, rows) ||
+        !parse_arg(argc, argv, 3, steps))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::println("{} bodies, {} steps", columns * rows, steps);
+    std::println("workers,mean_step_ms,speedup");
+
+    auto single_worker_time = 0.0;
+    for (int workers = 1; workers <= TaskScheduler::max_worker_count(); workers++)
+    {
+        TaskScheduler scheduler(workers);
+        auto world = create_pile(scheduler, columns, rows);
+        for (int i = 0; i < WARMUP_STEPS; i++)
+        {
+            b2World_Step(world, TIMESTEP, SUB_STEPS);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < steps; i++)
+        {
+            b2World_Step(world, TIMESTEP, SUB_STEPS);
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        b2DestroyWorld(world);
+
+        auto mean = elapsed.count() / steps;
+        if (workers == 1)
+        {
+            single_worker_time = mean;
+        }
+        std::println("{},{:.3f},{:.2f}", workers, mean, single_worker_time / mean);
+    }
+}
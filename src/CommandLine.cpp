@@ -0,0 +1,155 @@
+#include "CommandLine.h"
+
+#include <charconv>
+#include <iostream>
+#include <print>
+#include <random>
+#include <string_view>
+
+namespace
+{
+    template <typename T>
+    bool parse_value(std::string_view text, T& value)
+    {
+        auto end = text.data() + text.size();
+        auto [ptr, ec] = std::from_chars(text.data(), end, value);
+        return ec == std::errc{} && ptr == end;
+    }
+} // namespace
+
+std::optional<CommandLineOptions> parse_command_line(int argc, char** argv)
+{
+    CommandLineOptions options;
+    options.worker_count = TaskScheduler::max_worker_count();
+    options.scene.seed = std::random_device{}();
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--headless")
+        {
+            options.headless = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h")
+        {
+            options.show_help = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            std::println(std::cerr, "Missing value for '{}'.", arg);
+            return {};
+        }
+        std::string_view value = argv[++i];
+
+        bool valid = false;
+        if (arg == "--bodies")
+        {
+            valid = parse_value(value, options.scene.box_count) && options.scene.box_count >= 0;
+        }
+        else if (arg == "--static-bodies")
+        {
+            valid = parse_value(value, options.scene.static_box_count) &&
+                    options.scene.static_box_count >= 0;
+        }
+        else if (arg == "--build-batch")
+        {
+            valid = parse_value(value, options.scene.build_batch) && options.scene.build_batch >= 0;
+        }
+        else if (arg == "--steps")
+        {
+            valid = parse_value(value, options.steps) && options.steps > 0;
+        }
+        else if (arg == "--timestep")
+        {
+            valid = parse_value(value, options.timestep) && options.timestep > 0.0f;
+        }
+        else if (arg == "--sub-steps")
+        {
+            valid = parse_value(value, options.sub_steps) && options.sub_steps > 0;
+        }
+        else if (arg == "--workers")
+        {
+            valid = parse_value(value, options.worker_count) && options.worker_count > 0;
+        }
+        else if (arg == "--seed")
+        {
+            valid = parse_value(value, options.scene.seed);
+        }
+        else if (arg == "--trace-frames")
+        {
+            valid = parse_value(value, options.trace_frames) && options.trace_frames > 0;
+        }
+        else if (arg == "--trace-file")
+        {
+            options.trace_path = value;
+            valid = !value.empty();
+        }
+        else if (arg == "--load-scene")
+        {
+            options.load_scene_path = value;
+            valid = !value.empty();
+        }
+        else if (arg == "--save-scene")
+        {
+            options.save_scene_path = value;
+            valid = !value.empty();
+        }
+        else if (arg == "--record")
+        {
+            options.record_path = value;
+            valid = !value.empty();
+        }
+        else if (arg == "--replay")
+        {
+            options.replay_path = value;
+            valid = !value.empty();
+        }
+        else if (arg == "--serve")
+        {
+            valid = parse_value(value, options.serve_port) && options.serve_port > 0;
+        }
+        else if (arg == "--connect")
+        {
+            options.connect_address = value;
+            valid = !value.empty();
+        }
+        else
+        {
+            std::println(std::cerr, "Unknown option '{}'.", arg);
+            return {};
+        }
+
+        if (!valid)
+        {
+            std::println(std::cerr, "Invalid value '{}' for '{}'.", value, arg);
+            return {};
+        }
+    }
+    return options;
+}
+
+void print_usage()
+{
+    std::println("Usage: box2d-example [options]");
+    std::println("");
+    std::println("  --headless            Run without a window and print step time statistics");
+    std::println("  --bodies <n>          Number of dynamic boxes (default 200)");
+    std::println("  --static-bodies <n>   Number of random static boxes (default 5)");
+    std::println("  --build-batch <n>     Create the boxes n per step rather than all up front");
+    std::println("  --steps <n>           Headless only: number of steps to run (default 1000)");
+    std::println("  --timestep <seconds>  Length of a physics step (default 1/60)");
+    std::println("  --sub-steps <n>       Box2D sub-steps per step (default 4)");
+    std::println("  --workers <n>         Threads used to step the world (default all cores)");
+    std::println("  --seed <n>            Seed of the scene (default random)");
+    std::println("  --trace-frames <n>    Capture a Chrome trace of the first n frames (steps)");
+    std::println("  --trace-file <path>   Where the trace is written (default trace.json)");
+    std::println("  --load-scene <path>   Load the scene from a file instead of generating it");
+    std::println("  --save-scene <path>   Where the scene is saved (headless: once it is built)");
+    std::println("  --record <path>       Record the session's commands to a journal");
+    std::println("  --replay <path>       Replay a journal, with the scene it was recorded in");
+    std::println("  --serve <port>        Stream the bodies to viewers over UDP on the port");
+    std::println("  --connect <addr:port> Run as a viewer of a server started with --serve");
+}
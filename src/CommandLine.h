@@ -0,0 +1,49 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "Physics/Simulation.h"
+
+struct CommandLineOptions
+{
+    /// Run the simulation without a window and print step time statistics
+    bool headless = false;
+    bool show_help = false;
+
+    SceneSettings scene;
+    int worker_count = 1;
+    float timestep = 1.0f / 60.0f;
+    int sub_steps = 4;
+
+    /// Headless only: The number of steps to run
+    int steps = 1000;
+
+    /// Capture a trace of the first frames, or steps when headless, written to trace_path
+    int trace_frames = 0;
+    std::string trace_path = "trace.json";
+
+    /// Load the scene from this scene file rather than generating it, if set
+    std::string load_scene_path;
+
+    /// Where the scene is saved. Headless runs save the scene once it is built, if set.
+    std::string save_scene_path;
+
+    /// Record the commands and step rates of the session to this journal, if set
+    std::string record_path;
+
+    /// Replay this journal, building its scene and running its commands at the steps they were
+    /// recorded at, if set
+    std::string replay_path;
+
+    /// Stream the bodies to viewers connecting on this UDP port, if set
+    unsigned short serve_port = 0;
+
+    /// Run as a viewer of the server at "address:port" rather than simulating, if set
+    std::string connect_address;
+};
+
+/// Parses the arguments given to main, printing the problem to std::cerr if any are invalid
+std::optional<CommandLineOptions> parse_command_line(int argc, char** argv);
+
+void print_usage();
@@ -0,0 +1,280 @@
+#include "BodyRenderer.h"
+
+#include <algorithm>
+
+#include "PolygonMesh.h"
+
+namespace
+{
+    /// Compacting is not worth it for a few vertices
+    constexpr std::size_t MIN_COMPACTED_VERTICES = 4096;
+
+    void transform_vertices(std::span<sf::Vertex> vertices, std::span<const b2Vec2> local_points,
+                            b2Transform transform)
+    {
+        for (std::size_t i = 0; i < vertices.size(); i++)
+        {
+            auto point = b2TransformPoint(transform, local_points[i]);
+            vertices[i].position = {point.x, point.y};
+        }
+    }
+
+    void draw_vertices(sf::RenderTarget& target, const std::vector<sf::Vertex>& vertices,
+                       const sf::RenderStates& states)
+    {
+        if (!vertices.empty())
+        {
+            target.draw(vertices.data(), vertices.size(), sf::PrimitiveType::Triangles, states);
+        }
+    }
+} // namespace
+
+BodyRenderer::BodyRenderer(float outline_thickness)
+    : outline_thickness_(outline_thickness)
+{
+}
+
+void BodyRenderer::add_body(std::uint32_t slot_index, std::span<const b2Polygon> polygons,
+                            b2Transform transform, sf::Color colour)
+{
+    mesh_fill_.clear();
+    mesh_outline_.clear();
+    for (auto& polygon : polygons)
+    {
+        append_polygon_mesh(polygon, outline_thickness_, mesh_fill_, mesh_outline_);
+    }
+    auto fill_count = static_cast<std::uint32_t>(mesh_fill_.size());
+    auto outline_count = static_cast<std::uint32_t>(mesh_outline_.size());
+
+    if (slot_index >= slots_.size())
+    {
+        slots_.resize(slot_index + 1);
+    }
+    auto& slot = slots_[slot_index];
+
+    // Reuse the vertices of the body that was in the slot if the new one fits, otherwise they are
+    // left unused until the next compaction and the new body's vertices are appended
+    if (slot.removed && slot.fill_count == fill_count && slot.outline_count == outline_count)
+    {
+        unused_vertices_ -= fill_count + outline_count;
+    }
+    else
+    {
+        if (!slot.removed)
+        {
+            unused_vertices_ += slot.fill_count + slot.outline_count;
+        }
+        slot.fill_begin = static_cast<std::uint32_t>(fill_.size());
+        slot.outline_begin = static_cast<std::uint32_t>(outline_.size());
+        slot.fill_count = fill_count;
+        slot.outline_count = outline_count;
+        fill_.resize(fill_.size() + fill_count);
+        fill_local_.resize(fill_local_.size() + fill_count);
+        outline_.resize(outline_.size() + outline_count);
+        outline_local_.resize(outline_local_.size() + outline_count);
+    }
+    if (slot.removed)
+    {
+        body_count_++;
+    }
+    slot.removed = false;
+
+    std::ranges::copy(mesh_fill_, fill_local_.begin() + slot.fill_begin);
+    std::ranges::copy(mesh_outline_, outline_local_.begin() + slot.outline_begin);
+    for (std::uint32_t i = 0; i < fill_count; i++)
+    {
+        fill_[slot.fill_begin + i].color = colour;
+    }
+    for (std::uint32_t i = 0; i < outline_count; i++)
+    {
+        outline_[slot.outline_begin + i].color = sf::Color::White;
+    }
+
+    teleport(slot_index, transform);
+}
+
+void BodyRenderer::remove_body(std::uint32_t slot_index)
+{
+    // The vertices are collapsed to a point, so the triangles cover nothing when drawn without
+    // culling. The slot leaves the moving list the next time the bodies are interpolated.
+    auto& slot = slots_[slot_index];
+    if (slot.removed)
+    {
+        return;
+    }
+    slot.removed = true;
+    body_count_--;
+    unused_vertices_ += slot.fill_count + slot.outline_count;
+    for (std::uint32_t i = 0; i < slot.fill_count; i++)
+    {
+        fill_[slot.fill_begin + i].position = {};
+    }
+    for (std::uint32_t i = 0; i < slot.outline_count; i++)
+    {
+        outline_[slot.outline_begin + i].position = {};
+    }
+}
+
+void BodyRenderer::begin_step()
+{
+    for (auto index : moving_)
+    {
+        auto& slot = slots_[index];
+        slot.previous = slot.current;
+        slot.moved_in_step = false;
+    }
+}
+
+void BodyRenderer::set_transform(std::uint32_t slot_index, b2Transform transform)
+{
+    auto& slot = slots_[slot_index];
+    slot.current = transform;
+    slot.moved_in_step = true;
+    if (!slot.moving)
+    {
+        slot.moving = true;
+        moving_.push_back(slot_index);
+    }
+}
+
+void BodyRenderer::teleport(std::uint32_t slot_index, b2Transform transform)
+{
+    auto& slot = slots_[slot_index];
+    slot.previous = transform;
+    slot.current = transform;
+    write_vertices(slot, transform);
+}
+
+void BodyRenderer::interpolate(float alpha)
+{
+    if (unused_vertices_ >= MIN_COMPACTED_VERTICES &&
+        unused_vertices_ * 2 >= fill_.size() + outline_.size())
+    {
+        compact();
+    }
+
+    std::erase_if(moving_, [&](std::uint32_t index) {
+        auto& slot = slots_[index];
+        if (slot.removed)
+        {
+            slot.moving = false;
+            return true;
+        }
+        write_vertices(slot, {
+                                 .p = b2Lerp(slot.previous.p, slot.current.p, alpha),
+                                 .q = b2NLerp(slot.previous.q, slot.current.q, alpha),
+                             });
+
+        // Bodies that did not move in the latest step have now been written at their final
+        // transform, so can be left alone until they move again
+        slot.moving = slot.moved_in_step;
+        return !slot.moving;
+    });
+}
+
+void BodyRenderer::write_vertices(const Slot& slot, b2Transform transform)
+{
+    transform_vertices({fill_.data() + slot.fill_begin, slot.fill_count},
+                       {fill_local_.data() + slot.fill_begin, slot.fill_count}, transform);
+    transform_vertices({outline_.data() + slot.outline_begin, slot.outline_count},
+                       {outline_local_.data() + slot.outline_begin, slot.outline_count},
+                       transform);
+}
+
+void BodyRenderer::compact()
+{
+    while (!slots_.empty() && slots_.back().removed)
+    {
+        slots_.pop_back();
+    }
+    auto slot_count = slots_.size();
+    std::erase_if(moving_, [&](std::uint32_t index) { return index >= slot_count; });
+    std::erase_if(visible_slots_, [&](std::uint32_t index) { return index >= slot_count; });
+
+    // The slots are in the order of their vertices, so each range moves down in place
+    std::vector<std::uint32_t> order(slots_.size());
+    for (std::uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::ranges::sort(order, {}, [&](std::uint32_t index) { return slots_[index].fill_begin; });
+
+    std::uint32_t fill_end = 0;
+    std::uint32_t outline_end = 0;
+    for (auto index : order)
+    {
+        auto& slot = slots_[index];
+        if (slot.removed)
+        {
+            slot.fill_begin = 0;
+            slot.fill_count = 0;
+            slot.outline_begin = 0;
+            slot.outline_count = 0;
+            continue;
+        }
+
+        std::copy_n(fill_.begin() + slot.fill_begin, slot.fill_count, fill_.begin() + fill_end);
+        std::copy_n(fill_local_.begin() + slot.fill_begin, slot.fill_count,
+                    fill_local_.begin() + fill_end);
+        std::copy_n(outline_.begin() + slot.outline_begin, slot.outline_count,
+                    outline_.begin() + outline_end);
+        std::copy_n(outline_local_.begin() + slot.outline_begin, slot.outline_count,
+                    outline_local_.begin() + outline_end);
+        slot.fill_begin = fill_end;
+        slot.outline_begin = outline_end;
+        fill_end += slot.fill_count;
+        outline_end += slot.outline_count;
+    }
+
+    fill_.resize(fill_end);
+    fill_local_.resize(fill_end);
+    outline_.resize(outline_end);
+    outline_local_.resize(outline_end);
+    unused_vertices_ = 0;
+}
+
+void BodyRenderer::set_visible(std::span<const std::uint32_t> slots)
+{
+    visible_slots_.assign(slots.begin(), slots.end());
+}
+
+void BodyRenderer::draw(sf::RenderTarget& target, const sf::RenderStates& states, bool culled)
+{
+    if (!culled)
+    {
+        draw_vertices(target, fill_, states);
+        if (draw_outlines)
+        {
+            draw_vertices(target, outline_, states);
+        }
+        return;
+    }
+
+    visible_fill_.clear();
+    visible_outline_.clear();
+    for (auto index : visible_slots_)
+    {
+        auto& slot = slots_[index];
+        auto fill = fill_.begin() + slot.fill_begin;
+        visible_fill_.insert(visible_fill_.end(), fill, fill + slot.fill_count);
+        if (draw_outlines)
+        {
+            auto outline = outline_.begin() + slot.outline_begin;
+            visible_outline_.insert(visible_outline_.end(), outline,
+                                    outline + slot.outline_count);
+        }
+    }
+
+    draw_vertices(target, visible_fill_, states);
+    draw_vertices(target, visible_outline_, states);
+}
+
+std::size_t BodyRenderer::body_count() const
+{
+    return body_count_;
+}
+
+std::size_t BodyRenderer::visible_count() const
+{
+    return visible_slots_.size();
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <box2d/box2d.h>
+
+/// Keeps the vertices of every body in one persistent array, so the whole world can be submitted
+/// in one draw call for the fills (and one for the outlines) rather than one per body.
+///
+/// Each body owns a slot in the array, which is only rewritten while the body is moving, so bodies
+/// that are asleep cost nothing per frame. Moving bodies are drawn blended between their
+/// transforms from the last two physics steps, so rendering is smooth regardless of how many steps
+/// run per frame.
+///
+/// Removed bodies leave their vertices collapsed in the array until they make up half of it, when
+/// the array is compacted and trailing empty slots are trimmed.
+///
+/// All vertices are in Box2D meters, the meters to pixels transform is given when drawing.
+class BodyRenderer
+{
+  public:
+    /// @param outline_thickness The thickness of the body outlines in meters
+    explicit BodyRenderer(float outline_thickness);
+
+    /// Adds the convex polygons of a body to the cache in the given slot, with vertices relative
+    /// to the transform. Slots are expected to be dense, as every slot up to it is allocated.
+    ///
+    /// A removed slot can be given a new body, which reuses the slot's vertices when it has as
+    /// many as the new body needs.
+    void add_body(std::uint32_t slot, std::span<const b2Polygon> polygons, b2Transform transform,
+                  sf::Color colour);
+
+    /// Stops drawing the body in the slot
+    void remove_body(std::uint32_t slot);
+
+    /// Must be called before giving bodies their transforms from a new physics step
+    void begin_step();
+
+    /// Gives the body in the slot its transform at the end of the current physics step
+    void set_transform(std::uint32_t slot, b2Transform transform);
+
+    /// Moves the body in the slot without blending from where it was, for when it is teleported
+    /// outside of a physics step
+    void teleport(std::uint32_t slot, b2Transform transform);
+
+    /// Rewrites the vertices of the moving bodies, blending from their previous transform (alpha
+    /// = 0) to their latest (alpha = 1), compacting the vertices first if many are unused
+    void interpolate(float alpha);
+
+    /// When culling, only the visible slots are drawn
+    void set_visible(std::span<const std::uint32_t> slots);
+
+    void draw(sf::RenderTarget& target, const sf::RenderStates& states, bool culled);
+
+    /// The number of bodies being drawn, not counting removed slots
+    std::size_t body_count() const;
+    std::size_t visible_count() const;
+
+    bool draw_outlines = true;
+
+  private:
+    struct Slot
+    {
+        std::uint32_t fill_begin = 0;
+        std::uint32_t fill_count = 0;
+        std::uint32_t outline_begin = 0;
+        std::uint32_t outline_count = 0;
+
+        b2Transform previous = b2Transform_identity;
+        b2Transform current = b2Transform_identity;
+
+        /// In the moving_ list
+        bool moving = false;
+
+        /// Given a transform since the last begin_step
+        bool moved_in_step = false;
+
+        /// Slots are empty until a body is added
+        bool removed = true;
+    };
+
+    void write_vertices(const Slot& slot, b2Transform transform);
+
+    /// Packs the vertices of the bodies together, dropping those of removed slots
+    void compact();
+
+    std::vector<Slot> slots_;
+    std::size_t body_count_ = 0;
+
+    /// Vertices in the arrays that no body uses, either collapsed or from a previous shape
+    std::size_t unused_vertices_ = 0;
+
+    /// Slots that moved in the latest step, and so need their vertices rewriting every frame
+    std::vector<std::uint32_t> moving_;
+
+    // The vertices of every slot, with the untransformed local points alongside them
+    std::vector<sf::Vertex> fill_;
+    std::vector<b2Vec2> fill_local_;
+    std::vector<sf::Vertex> outline_;
+    std::vector<b2Vec2> outline_local_;
+
+    // Copies of the visible slots' vertices, rebuilt every frame when culling
+    std::vector<std::uint32_t> visible_slots_;
+    std::vector<sf::Vertex> visible_fill_;
+    std::vector<sf::Vertex> visible_outline_;
+
+    // The mesh of the body being added, before it is known where its vertices go
+    std::vector<b2Vec2> mesh_fill_;
+    std::vector<b2Vec2> mesh_outline_;
+
+    float outline_thickness_;
+};
@@ -0,0 +1,55 @@
+#include "Camera.h"
+
+#include <SFML/Window/Keyboard.hpp>
+
+namespace
+{
+    /// Camera movement speed
+    constexpr float CAMERA_SPEED = 10.0f;
+} // namespace
+
+void Camera::update(sf::Time dt)
+{
+    sf::Vector2f change{};
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::A))
+    {
+        change.x += -CAMERA_SPEED;
+    }
+    else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::D))
+    {
+        change.x += CAMERA_SPEED;
+    }
+    if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W))
+    {
+        change.y += -CAMERA_SPEED;
+    }
+    else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S))
+    {
+        change.y += CAMERA_SPEED;
+    }
+
+    speed += change * dt.asSeconds();
+    view.move(speed);
+    speed *= 0.95f;
+}
+
+sf::RenderStates to_sfml_render_states(int window_height)
+{
+    // Flip Y and scale up to pixels, so (x, y) meters becomes (x, window_height - y) pixels
+    sf::RenderStates states;
+    states.transform.translate({0.0f, static_cast<float>(window_height)})
+        .scale({SCALE, -SCALE});
+    return states;
+}
+
+b2AABB to_box2d_aabb(const sf::View& view, int window_height)
+{
+    auto top_left = view.getCenter() - view.getSize() / 2.0f;
+    auto bottom_right = view.getCenter() + view.getSize() / 2.0f;
+
+    // Y is inverted between SFML and Box2D, so the bottom of the view is the lower bound
+    return {
+        .lowerBound = {top_left.x / SCALE, (window_height - bottom_right.y) / SCALE},
+        .upperBound = {bottom_right.x / SCALE, (window_height - top_left.y) / SCALE},
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/View.hpp>
+#include <SFML/System/Time.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <box2d/box2d.h>
+
+/// Convert between Box2D and SFML sizes, so 1 meter = 'SCALE' pixels
+constexpr float SCALE = 8.f;
+
+/// A view of the world that glides around with WASD
+struct Camera
+{
+    sf::View view;
+    sf::Vector2f speed;
+
+    /// Accelerates the camera with the keys that are held, and moves it
+    void update(sf::Time dt);
+};
+
+/// Render states that transform geometry in Box2D meters to SFML pixels, flipping Y so the
+/// bottom left of the window is the origin
+sf::RenderStates to_sfml_render_states(int window_height);
+
+/// Converts the area of the world the view can see from pixels to a Box2D AABB in meters
+b2AABB to_box2d_aabb(const sf::View& view, int window_height);
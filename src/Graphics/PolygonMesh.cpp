@@ -0,0 +1,33 @@
+#include "PolygonMesh.h"
+
+void append_polygon_mesh(const b2Polygon& polygon, float outline_thickness,
+                         std::vector<b2Vec2>& fill, std::vector<b2Vec2>& outline)
+{
+    auto points = polygon.vertices;
+    auto count = polygon.count;
+
+    // Triangle fan, but as a triangle list
+    for (int i = 1; i < count - 1; i++)
+    {
+        fill.insert(fill.end(), {points[0], points[i], points[i + 1]});
+    }
+
+    // Each edge becomes a thin quad pushed outwards along the edge normal, matching how SFML
+    // shapes draw their outlines
+    for (int i = 0; i < count; i++)
+    {
+        auto a = points[i];
+        auto b = points[(i + 1) % count];
+        auto edge = b2Sub(b, a);
+        auto length = b2Length(edge);
+        if (length <= 0.0f)
+        {
+            continue;
+        }
+        // Box2D polygons wind counter-clockwise, so the outward normal is to the right
+        auto offset = b2MulSV(outline_thickness / length, {edge.y, -edge.x});
+
+        outline.insert(outline.end(),
+                       {a, b, b2Add(b, offset), a, b2Add(b, offset), b2Add(a, offset)});
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include <box2d/box2d.h>
+
+/// Appends the triangles of a convex, counter-clockwise polygon to the fill points, and thin quads
+/// around its edges to the outline points. Both are appended as triangle lists so many polygons
+/// can share the one array.
+void append_polygon_mesh(const b2Polygon& polygon, float outline_thickness,
+                         std::vector<b2Vec2>& fill, std::vector<b2Vec2>& outline);
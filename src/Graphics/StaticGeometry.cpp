@@ -0,0 +1,101 @@
+#include "StaticGeometry.h"
+
+#include <iostream>
+#include <print>
+
+#include "PolygonMesh.h"
+
+StaticGeometry::StaticGeometry(float outline_thickness)
+    : outline_thickness_(outline_thickness)
+{
+}
+
+std::uint32_t StaticGeometry::add_body(std::span<const b2Polygon> polygons,
+                                       b2Transform transform, sf::Color colour)
+{
+    bodies_.push_back({
+        .polygons = {polygons.begin(), polygons.end()},
+        .transform = transform,
+        .colour = colour,
+    });
+    needs_rebuild_ = true;
+    return static_cast<std::uint32_t>(bodies_.size() - 1);
+}
+
+void StaticGeometry::remove_body(std::uint32_t id)
+{
+    bodies_[id].removed = true;
+    needs_rebuild_ = true;
+}
+
+void StaticGeometry::draw(sf::RenderTarget& target, const sf::RenderStates& states)
+{
+    if (needs_rebuild_)
+    {
+        rebuild();
+    }
+    if (vertices_.empty())
+    {
+        return;
+    }
+
+    auto count = draw_outlines ? vertices_.size() : fill_count_;
+    if (sf::VertexBuffer::isAvailable())
+    {
+        target.draw(buffer_, 0, count, states);
+    }
+    else
+    {
+        target.draw(vertices_.data(), count, sf::PrimitiveType::Triangles, states);
+    }
+}
+
+void StaticGeometry::rebuild()
+{
+    needs_rebuild_ = false;
+
+    std::vector<b2Vec2> fill;
+    std::vector<b2Vec2> outline;
+    std::vector<sf::Color> fill_colours;
+    for (auto& body : bodies_)
+    {
+        if (body.removed)
+        {
+            continue;
+        }
+
+        auto begin = fill.size();
+        for (auto& polygon : body.polygons)
+        {
+            auto world_polygon = polygon;
+            for (int i = 0; i < polygon.count; i++)
+            {
+                world_polygon.vertices[i] = b2TransformPoint(body.transform, polygon.vertices[i]);
+            }
+            append_polygon_mesh(world_polygon, outline_thickness_, fill, outline);
+        }
+        fill_colours.insert(fill_colours.end(), fill.size() - begin, body.colour);
+    }
+
+    vertices_.clear();
+    vertices_.reserve(fill.size() + outline.size());
+    for (std::size_t i = 0; i < fill.size(); i++)
+    {
+        vertices_.push_back({{fill[i].x, fill[i].y}, fill_colours[i], {}});
+    }
+    for (auto point : outline)
+    {
+        vertices_.push_back({{point.x, point.y}, sf::Color::White, {}});
+    }
+    fill_count_ = fill.size();
+
+    if (sf::VertexBuffer::isAvailable() && !vertices_.empty())
+    {
+        bool created =
+            buffer_.getVertexCount() == vertices_.size() || buffer_.create(vertices_.size());
+        if (!created || !buffer_.update(vertices_.data()))
+        {
+            std::println(std::cerr, "Failed to upload the static geometry vertex buffer.");
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SFML/Graphics/RenderStates.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+#include <SFML/Graphics/VertexBuffer.hpp>
+#include <box2d/box2d.h>
+
+/// Static bodies never move, so their geometry is baked once into a single vertex buffer that
+/// lives on the GPU, and is only rebuilt when a static body is added or removed.
+///
+/// All vertices are in Box2D meters, the meters to pixels transform is given when drawing.
+class StaticGeometry
+{
+  public:
+    /// @param outline_thickness The thickness of the body outlines in meters
+    explicit StaticGeometry(float outline_thickness);
+
+    /// Adds the convex polygons of a body, with vertices relative to the transform
+    /// @return The id used to remove the body
+    std::uint32_t add_body(std::span<const b2Polygon> polygons, b2Transform transform,
+                           sf::Color colour);
+    void remove_body(std::uint32_t id);
+
+    void draw(sf::RenderTarget& target, const sf::RenderStates& states);
+
+    bool draw_outlines = true;
+
+  private:
+    struct Body
+    {
+        std::vector<b2Polygon> polygons;
+        b2Transform transform;
+        sf::Color colour;
+        bool removed = false;
+    };
+
+    void rebuild();
+
+    std::vector<Body> bodies_;
+
+    // Fill vertices come first in the buffer, followed by the outlines
+    sf::VertexBuffer buffer_{sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Static};
+    std::vector<sf::Vertex> vertices_;
+    std::size_t fill_count_ = 0;
+    bool needs_rebuild_ = false;
+
+    float outline_thickness_;
+};
@@ -0,0 +1,94 @@
+#include "Headless.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <print>
+#include <vector>
+
+#include <SFML/System/Clock.hpp>
+
+#include "CommandLine.h"
+#include "Physics/Journal.h"
+#include "Physics/SceneFile.h"
+#include "Util/Statistics.h"
+#include "Util/Trace.h"
+
+int run_headless(const CommandLineOptions& options, const Journal* replay,
+                 const SceneFile* scene_file)
+{
+    TaskScheduler scheduler(options.worker_count);
+
+    sf::Clock build_clock;
+    Simulation simulation(options.scene, scheduler, scene_file);
+    auto build_time = build_clock.getElapsedTime();
+
+    if (!options.save_scene_path.empty() && !SceneFile::save(simulation, options.save_scene_path))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::optional<Journal> recording;
+    if (!options.record_path.empty())
+    {
+        recording.emplace(options.scene, scheduler.worker_count());
+        if (scene_file)
+        {
+            recording->set_scene_file(options.load_scene_path, *scene_file);
+        }
+        simulation.record(&*recording);
+    }
+
+    auto steps = static_cast<std::uint64_t>(options.steps);
+    if (replay)
+    {
+        simulation.replay(*replay);
+        steps = replay->step_count();
+        std::println("Replaying '{}'", options.replay_path);
+    }
+
+    std::println("{} dynamic bodies, {} steps of {:.3f}ms with {} sub-steps, {} workers, seed {}",
+                 options.scene.box_count, steps, options.timestep * 1000.0f, options.sub_steps,
+                 scheduler.worker_count(), options.scene.seed);
+    std::println("Build:  {:.3f}ms", build_time.asMicroseconds() / 1000.0);
+
+    std::vector<double> step_times;
+    step_times.reserve(steps);
+
+    // Each step is a frame of the trace, and a capture longer than the run would never be written
+    Trace::set_thread_name("Main");
+    if (options.trace_frames > 0 && steps > 0)
+    {
+        auto frames = std::min(static_cast<std::uint64_t>(options.trace_frames), steps);
+        Trace::begin_capture(static_cast<int>(frames), options.trace_path);
+    }
+
+    sf::Clock clock;
+    for (std::uint64_t i = 0; i < steps; i++)
+    {
+        clock.restart();
+        simulation.step(options.timestep, options.sub_steps);
+        step_times.push_back(clock.getElapsedTime().asMicroseconds() / 1000.0);
+
+        // Nothing renders the events, but they must be taken so they do not build up
+        simulation.take_events();
+        Trace::end_frame();
+    }
+
+    auto statistics = calculate_statistics(step_times);
+    std::println("Total:  {:.3f}ms", statistics.total);
+    std::println("Mean:   {:.3f}ms", statistics.mean);
+    std::println("Min:    {:.3f}ms", statistics.min);
+    std::println("p50:    {:.3f}ms", statistics.p50);
+    std::println("p90:    {:.3f}ms", statistics.p90);
+    std::println("p99:    {:.3f}ms", statistics.p99);
+    std::println("Max:    {:.3f}ms", statistics.max);
+    std::println("Steps per second: {:.1f}",
+                 static_cast<double>(step_times.size()) / (statistics.total / 1000.0));
+
+    if (recording && !recording->save(options.record_path))
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
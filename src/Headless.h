@@ -0,0 +1,12 @@
+#pragma once
+
+struct CommandLineOptions;
+class Journal;
+class SceneFile;
+
+/// Steps the scene without a window and prints the step time statistics
+/// @param replay If set, replayed for as many steps as it recorded rather than options.steps
+/// @param scene_file If set, the scene is loaded from it
+/// @return The exit code
+int run_headless(const CommandLineOptions& options, const Journal* replay,
+                 const SceneFile* scene_file);
@@ -0,0 +1,37 @@
+#include "Protocol.h"
+
+#include <cmath>
+
+NetworkBody quantize(std::uint32_t id, std::uint32_t generation, b2Transform transform)
+{
+    // Angles wrap around, so the angle is taken modulo a turn by the cast
+    auto angle = static_cast<std::int32_t>(std::lround(b2Rot_GetAngle(transform.q) * ANGLE_SCALE));
+    return {
+        .id = id,
+        .generation = generation,
+        .x = static_cast<std::int32_t>(std::lround(transform.p.x * POSITION_SCALE)),
+        .y = static_cast<std::int32_t>(std::lround(transform.p.y * POSITION_SCALE)),
+        .angle = static_cast<std::uint16_t>(angle),
+    };
+}
+
+b2Transform dequantize(const NetworkBody& body)
+{
+    return {
+        .p = {static_cast<float>(body.x) / POSITION_SCALE,
+              static_cast<float>(body.y) / POSITION_SCALE},
+        .q = b2MakeRot(static_cast<float>(body.angle) / ANGLE_SCALE),
+    };
+}
+
+bool read_header(ByteReader& reader, MessageType& type)
+{
+    std::array<char, 4> magic;
+    return reader.read_bytes(std::span(magic)) && magic == NETWORK_MAGIC && reader.read(type);
+}
+
+void write_header(ByteWriter& writer, MessageType type)
+{
+    writer.write_bytes(std::span(NETWORK_MAGIC));
+    writer.write(type);
+}
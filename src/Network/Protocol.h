@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <box2d/box2d.h>
+
+#include "../Util/ByteBuffer.h"
+
+/// The messages sent between the snapshot server and its viewers over UDP.
+///
+/// A viewer sends Hello until the first snapshot arrives, then an Ack for each snapshot it
+/// completes, carrying the area its camera can see. Every datagram starts with the magic and the
+/// message type:
+///
+///     Hello:    view area (lower x, lower y, upper x, upper y)
+///     Ack:      sequence, view area
+///     Snapshot: sequence, baseline, fragment index, fragment count, then body records
+///
+/// A snapshot only holds the bodies that differ from the baseline, the latest snapshot the viewer
+/// acknowledged, so bodies that are asleep or off screen cost nothing. It is split into fragments
+/// small enough to never be split by IP, each with whole records. A record is the difference of
+/// the body's id from the previous record's, its BodyFlags, then:
+///
+///     BODY_FULL:    generation, x, y, angle, colour, polygon count, then each polygon's vertex
+///                   count and vertices
+///     BODY_REMOVED: nothing
+///     Otherwise:    whichever of x, y and angle changed, as the difference from the baseline
+///
+/// Ids, generations and differences are variable length, everything else is little endian.
+constexpr std::array<char, 4> NETWORK_MAGIC = {'B', '2', 'N', 'T'};
+
+enum class MessageType : std::uint8_t
+{
+    Hello,
+    Ack,
+    Snapshot,
+};
+
+/// Kept under the usual internet MTU
+constexpr std::size_t MAX_DATAGRAM_SIZE = 1200;
+
+/// How many snapshots each end keeps to be used as baselines
+constexpr std::uint32_t SNAPSHOT_HISTORY = 32;
+
+/// Positions are sent in 1/512ths of a metre and angles in 1/65536ths of a turn
+constexpr float POSITION_SCALE = 512.0f;
+constexpr float ANGLE_SCALE = 65536.0f / (2.0f * B2_PI);
+
+/// Dynamic and static bodies have separate slots, so the ids of static bodies have the top bit set
+constexpr std::uint32_t STATIC_BODY_ID = 0x8000'0000u;
+
+enum BodyFlags : std::uint8_t
+{
+    BODY_FULL = 1 << 0,
+    BODY_REMOVED = 1 << 1,
+    BODY_X = 1 << 2,
+    BODY_Y = 1 << 3,
+    BODY_ANGLE = 1 << 4,
+};
+
+/// A body as it is sent, quantized so bodies that have not moved compare equal
+struct NetworkBody
+{
+    std::uint32_t id;
+
+    /// Counts the bodies created in the slot, so a reused slot is sent with its new shape
+    std::uint32_t generation;
+    std::int32_t x;
+    std::int32_t y;
+    std::uint16_t angle;
+};
+
+/// The bodies a viewer can see at one moment, in order of id
+struct NetworkSnapshot
+{
+    std::uint32_t sequence = 0;
+    std::vector<NetworkBody> bodies;
+};
+
+NetworkBody quantize(std::uint32_t id, std::uint32_t generation, b2Transform transform);
+b2Transform dequantize(const NetworkBody& body);
+
+/// Reads the magic and message type every datagram starts with
+bool read_header(ByteReader& reader, MessageType& type);
+
+/// Starts a datagram with the magic and message type
+void write_header(ByteWriter& writer, MessageType type);
@@ -0,0 +1,341 @@
+#include "SnapshotClient.h"
+
+#include <charconv>
+#include <iostream>
+#include <print>
+#include <string_view>
+
+#include "../Util/Trace.h"
+
+namespace
+{
+    /// How often a hello is sent until the server answers, and an ack is sent again when no
+    /// snapshot has arrived, so the server knows the viewer is still there
+    const sf::Time RESEND_INTERVAL = sf::seconds(0.25f);
+
+    /// The baseline of the first snapshots
+    const NetworkSnapshot EMPTY_SNAPSHOT;
+} // namespace
+
+bool SnapshotClient::connect(const std::string& address)
+{
+    auto colon = address.rfind(':');
+    if (colon != std::string::npos)
+    {
+        std::string_view port = std::string_view(address).substr(colon + 1);
+        auto [end, error] = std::from_chars(port.data(), port.data() + port.size(), server_port_);
+        server_address_ = sf::IpAddress::resolve(address.substr(0, colon));
+        if (error != std::errc{} || end != port.data() + port.size())
+        {
+            server_address_.reset();
+        }
+    }
+    if (!server_address_ || server_port_ == 0)
+    {
+        std::println(std::cerr, "Invalid server '{}', expected <address>:<port>.", address);
+        return false;
+    }
+
+    if (socket_.bind(sf::Socket::AnyPort) != sf::Socket::Status::Done)
+    {
+        std::println(std::cerr, "Failed to open a socket to connect to '{}'.", address);
+        return false;
+    }
+    socket_.setBlocking(false);
+    buffer_.resize(sf::UdpSocket::MaxDatagramSize);
+
+    std::println("Connecting to {}:{}", server_address_->toString(), server_port_);
+    return true;
+}
+
+void SnapshotClient::set_view_area(b2AABB area)
+{
+    view_area_ = area;
+}
+
+const NetworkSnapshot* SnapshotClient::receive()
+{
+    TraceZone zone("Receive Snapshots");
+    bool completed = false;
+    std::size_t size = 0;
+    std::optional<sf::IpAddress> address;
+    unsigned short port = 0;
+    while (socket_.receive(buffer_.data(), buffer_.size(), size, address, port) ==
+           sf::Socket::Status::Done)
+    {
+        if (address != server_address_ || port != server_port_)
+        {
+            continue;
+        }
+        bytes_received_ += static_cast<int>(size);
+        completed |= receive_fragment({buffer_.data(), size});
+    }
+
+    if (statistics_clock_.getElapsedTime() >= sf::seconds(1.0f))
+    {
+        auto seconds = statistics_clock_.restart().asSeconds();
+        statistics_.bytes_per_second =
+            static_cast<int>(static_cast<float>(bytes_received_) / seconds);
+        statistics_.snapshots_per_second =
+            static_cast<int>(static_cast<float>(snapshots_received_) / seconds);
+        bytes_received_ = 0;
+        snapshots_received_ = 0;
+    }
+
+    // Acknowledged straight away, so the next snapshot is diffed against this one. The first hello
+    // is sent once the view area is known.
+    if (completed || !has_sent_ || ack_clock_.getElapsedTime() >= RESEND_INTERVAL)
+    {
+        send_ack();
+    }
+    return completed ? &history_[latest_ % SNAPSHOT_HISTORY] : nullptr;
+}
+
+const NetworkShape* SnapshotClient::shape(std::uint32_t id) const
+{
+    auto found = shapes_.find(id);
+    return found != shapes_.end() ? &found->second : nullptr;
+}
+
+bool SnapshotClient::is_connected() const
+{
+    return latest_ != 0;
+}
+
+const ClientStatistics& SnapshotClient::statistics() const
+{
+    return statistics_;
+}
+
+bool SnapshotClient::receive_fragment(std::span<const std::uint8_t> datagram)
+{
+    ByteReader reader(datagram);
+    MessageType type;
+    std::uint32_t sequence = 0;
+    std::uint32_t baseline = 0;
+    std::uint16_t index = 0;
+    std::uint16_t count = 0;
+    if (!read_header(reader, type) || type != MessageType::Snapshot || !reader.read(sequence) ||
+        !reader.read(baseline) || !reader.read(index) || !reader.read(count) || index >= count)
+    {
+        return false;
+    }
+
+    // Snapshots older than the latest are of no use
+    if (sequence <= latest_)
+    {
+        return false;
+    }
+
+    // The slot is taken over from an older snapshot that never completed. The fragments' buffers
+    // are kept, so they are not reallocated for every snapshot.
+    auto& assembly = assemblies_[sequence % assemblies_.size()];
+    if (assembly.sequence != sequence)
+    {
+        assembly.sequence = sequence;
+        assembly.baseline = baseline;
+        assembly.received = 0;
+        assembly.fragments.resize(count);
+        assembly.arrived.assign(count, 0);
+    }
+    if (assembly.arrived.size() != count || assembly.arrived[index])
+    {
+        return false;
+    }
+
+    auto records = datagram.subspan(datagram.size() - reader.remaining());
+    assembly.fragments[index].assign(records.begin(), records.end());
+    assembly.arrived[index] = 1;
+    if (++assembly.received < count)
+    {
+        return false;
+    }
+
+    // A snapshot that can not be read is counted as lost once a later one completes
+    return complete(assembly);
+}
+
+bool SnapshotClient::complete(const Assembly& assembly)
+{
+    sf::Clock clock;
+
+    // The baseline must still be kept, as the snapshot only holds what changed since
+    const NetworkSnapshot* baseline = &EMPTY_SNAPSHOT;
+    if (assembly.baseline != 0)
+    {
+        baseline = &history_[assembly.baseline % SNAPSHOT_HISTORY];
+        if (baseline->sequence != assembly.baseline)
+        {
+            return false;
+        }
+    }
+
+    decoded_.sequence = assembly.sequence;
+    decoded_.bodies.clear();
+    std::size_t baseline_index = 0;
+    for (auto& fragment : assembly.fragments)
+    {
+        if (!decode(fragment, *baseline, baseline_index))
+        {
+            return false;
+        }
+    }
+
+    // The bodies after the last record did not change
+    decoded_.bodies.insert(decoded_.bodies.end(), baseline->bodies.begin() + baseline_index,
+                           baseline->bodies.end());
+
+    // Decoded separately, as the new snapshot can take the place of its own baseline
+    std::swap(history_[assembly.sequence % SNAPSHOT_HISTORY], decoded_);
+    if (latest_ != 0)
+    {
+        statistics_.lost_snapshots += static_cast<int>(assembly.sequence - latest_ - 1);
+    }
+    latest_ = assembly.sequence;
+    snapshots_received_++;
+
+    if (++completed_since_forgetting_ >= static_cast<int>(SNAPSHOT_HISTORY))
+    {
+        forget_shapes();
+    }
+    statistics_.deserialize_time = clock.getElapsedTime();
+    return true;
+}
+
+bool SnapshotClient::decode(std::span<const std::uint8_t> fragment,
+                            const NetworkSnapshot& baseline, std::size_t& baseline_index)
+{
+    ByteReader reader(fragment);
+    auto& previous = baseline.bodies;
+    std::uint32_t id = 0;
+    while (!reader.at_end())
+    {
+        std::uint32_t id_delta;
+        std::uint8_t flags;
+        if (!reader.read_varint(id_delta) || !reader.read(flags))
+        {
+            return false;
+        }
+        id += id_delta;
+
+        // Both are in order of id, and the bodies between the records did not change
+        while (baseline_index < previous.size() && previous[baseline_index].id < id)
+        {
+            decoded_.bodies.push_back(previous[baseline_index++]);
+        }
+        const NetworkBody* before = nullptr;
+        if (baseline_index < previous.size() && previous[baseline_index].id == id)
+        {
+            before = &previous[baseline_index++];
+        }
+
+        if (flags & BODY_REMOVED)
+        {
+            continue;
+        }
+
+        NetworkBody body;
+        if (flags & BODY_FULL)
+        {
+            if (!decode_full(reader, id, body))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            std::int32_t x = 0;
+            std::int32_t y = 0;
+            std::int32_t angle = 0;
+            if (!before || ((flags & BODY_X) && !reader.read_signed(x)) ||
+                ((flags & BODY_Y) && !reader.read_signed(y)) ||
+                ((flags & BODY_ANGLE) && !reader.read_signed(angle)))
+            {
+                return false;
+            }
+            body = *before;
+            body.x += x;
+            body.y += y;
+            body.angle = static_cast<std::uint16_t>(body.angle + angle);
+        }
+        decoded_.bodies.push_back(body);
+    }
+    return true;
+}
+
+bool SnapshotClient::decode_full(ByteReader& reader, std::uint32_t id, NetworkBody& body)
+{
+    auto& shape = shapes_[id];
+    std::uint8_t polygon_count = 0;
+    body.id = id;
+    if (!reader.read_varint(body.generation) || !reader.read_signed(body.x) ||
+        !reader.read_signed(body.y) || !reader.read(body.angle) || !reader.read(shape.colour.r) ||
+        !reader.read(shape.colour.g) || !reader.read(shape.colour.b) ||
+        !reader.read(shape.colour.a) || !reader.read(polygon_count))
+    {
+        return false;
+    }
+
+    shape.generation = body.generation;
+    shape.polygons.clear();
+    for (std::uint8_t i = 0; i < polygon_count; i++)
+    {
+        std::uint8_t vertex_count = 0;
+        std::array<b2Vec2, B2_MAX_POLYGON_VERTICES> vertices;
+        if (!reader.read(vertex_count) || vertex_count < 3 ||
+            vertex_count > B2_MAX_POLYGON_VERTICES)
+        {
+            return false;
+        }
+        for (std::uint8_t j = 0; j < vertex_count; j++)
+        {
+            if (!reader.read(vertices[j]))
+            {
+                return false;
+            }
+        }
+
+        auto hull = b2ComputeHull(vertices.data(), vertex_count);
+        if (hull.count == 0)
+        {
+            return false;
+        }
+        shape.polygons.push_back(b2MakePolygon(&hull, 0));
+    }
+    return true;
+}
+
+void SnapshotClient::send_ack()
+{
+    ByteWriter writer;
+    if (latest_ == 0)
+    {
+        write_header(writer, MessageType::Hello);
+    }
+    else
+    {
+        write_header(writer, MessageType::Ack);
+        writer.write(latest_);
+    }
+    writer.write(view_area_.lowerBound);
+    writer.write(view_area_.upperBound);
+
+    // A lost ack is sent again with the next one
+    (void)socket_.send(writer.bytes().data(), writer.size(), *server_address_, server_port_);
+    ack_clock_.restart();
+    has_sent_ = true;
+}
+
+void SnapshotClient::forget_shapes()
+{
+    kept_ids_.clear();
+    for (auto& snapshot : history_)
+    {
+        for (auto& body : snapshot.bodies)
+        {
+            kept_ids_.insert(body.id);
+        }
+    }
+    std::erase_if(shapes_, [&](const auto& entry) { return !kept_ids_.contains(entry.first); });
+    completed_since_forgetting_ = 0;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+#include <box2d/box2d.h>
+
+#include "Protocol.h"
+
+/// What a body looks like, sent the first time it is in a viewer's snapshot
+struct NetworkShape
+{
+    std::uint32_t generation = 0;
+    sf::Color colour;
+    std::vector<b2Polygon> polygons;
+};
+
+/// What the viewer received, over the last second
+struct ClientStatistics
+{
+    int bytes_per_second = 0;
+    int snapshots_per_second = 0;
+
+    /// Snapshots with a datagram that never arrived, or diffed against a baseline that is no
+    /// longer kept
+    int lost_snapshots = 0;
+
+    /// Time taken to read the latest snapshot and apply it to its baseline
+    sf::Time deserialize_time;
+};
+
+/// Receives the snapshots a SnapshotServer streams, see Protocol.h
+class SnapshotClient
+{
+  public:
+    /// Opens a socket to the server at "address:port", printing the problem to std::cerr if it
+    /// can not
+    bool connect(const std::string& address);
+
+    /// The area the camera can see, so the server only sends the bodies around it
+    void set_view_area(b2AABB area);
+
+    /// Reads the datagrams that have arrived and acknowledges the completed snapshots, never
+    /// blocking
+    /// @return The latest snapshot, if a newer one was completed since the last call
+    const NetworkSnapshot* receive();
+
+    /// The shape of a body in the latest snapshot
+    const NetworkShape* shape(std::uint32_t id) const;
+
+    /// Whether a snapshot has arrived yet
+    bool is_connected() const;
+
+    const ClientStatistics& statistics() const;
+
+  private:
+    /// The records of each fragment of a snapshot, until they have all arrived
+    struct Assembly
+    {
+        std::uint32_t sequence = 0;
+        std::uint32_t baseline = 0;
+        std::uint16_t received = 0;
+        std::vector<std::vector<std::uint8_t>> fragments;
+        std::vector<std::uint8_t> arrived;
+    };
+
+    /// @return Whether it completed a snapshot newer than the latest
+    bool receive_fragment(std::span<const std::uint8_t> datagram);
+
+    /// Applies the fragments to the baseline as the latest snapshot
+    /// @return Whether the snapshot could be read
+    bool complete(const Assembly& assembly);
+
+    /// Reads the records of a fragment into decoded_
+    bool decode(std::span<const std::uint8_t> fragment, const NetworkSnapshot& baseline,
+                std::size_t& baseline_index);
+    bool decode_full(ByteReader& reader, std::uint32_t id, NetworkBody& body);
+
+    /// Sends a hello until the first snapshot arrives, then acknowledges the latest snapshot
+    void send_ack();
+
+    /// Forgets the shapes of bodies in none of the kept snapshots
+    void forget_shapes();
+
+    sf::UdpSocket socket_;
+    std::vector<std::uint8_t> buffer_;
+    std::optional<sf::IpAddress> server_address_;
+    unsigned short server_port_ = 0;
+    b2AABB view_area_{};
+    sf::Clock ack_clock_;
+    bool has_sent_ = false;
+
+    /// Snapshots arrive in several datagrams, which can overlap with the next snapshot's
+    std::array<Assembly, 4> assemblies_;
+    std::array<NetworkSnapshot, SNAPSHOT_HISTORY> history_{};
+    NetworkSnapshot decoded_;
+    std::uint32_t latest_ = 0;
+
+    std::unordered_map<std::uint32_t, NetworkShape> shapes_;
+    std::unordered_set<std::uint32_t> kept_ids_;
+    int completed_since_forgetting_ = 0;
+
+    sf::Clock statistics_clock_;
+    int bytes_received_ = 0;
+    int snapshots_received_ = 0;
+    ClientStatistics statistics_;
+};
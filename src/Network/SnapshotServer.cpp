@@ -0,0 +1,404 @@
+#include "SnapshotServer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <print>
+
+#include "../Util/Trace.h"
+
+namespace
+{
+    /// Viewers that have not been heard from for this long are assumed to have gone
+    const sf::Time VIEWER_TIMEOUT = sf::seconds(5.0f);
+
+    /// Bodies this far outside the view are sent too, so they are already there when the camera
+    /// moves onto them
+    constexpr float VIEW_MARGIN = 10.0f;
+
+    /// Where the fragment count is in a snapshot datagram, after the magic, message type,
+    /// sequence, baseline and fragment index
+    constexpr std::size_t FRAGMENT_COUNT_OFFSET = NETWORK_MAGIC.size() + 1 + 4 + 4 + 2;
+    constexpr std::size_t FRAGMENT_HEADER_SIZE = FRAGMENT_COUNT_OFFSET + 2;
+
+    /// The most bytes a 32 bit varint takes
+    constexpr std::size_t MAX_VARINT_SIZE = 5;
+
+    /// How many bytes of new bodies are sent in a snapshot. The rest wait for the next snapshots,
+    /// as a snapshot of many fragments is unlikely to arrive whole when datagrams are being lost.
+    constexpr std::size_t NEW_BODY_BUDGET = 4 * MAX_DATAGRAM_SIZE;
+} // namespace
+
+bool SnapshotServer::listen(unsigned short port)
+{
+    if (socket_.bind(port) != sf::Socket::Status::Done)
+    {
+        std::println(std::cerr, "Failed to listen for viewers on port {}.", port);
+        return false;
+    }
+    socket_.setBlocking(false);
+    std::println("Listening for viewers on port {}", port);
+    return true;
+}
+
+void SnapshotServer::apply_events(const StepEvents& events)
+{
+    // Slots are not reused within the events, so the order they are applied in does not matter
+    for (auto& created : events.created)
+    {
+        (created.is_static ? static_ : dynamic_).add(created.slot, created);
+    }
+    for (auto& moved : events.moved)
+    {
+        dynamic_.transforms[moved.slot] = moved.transform;
+    }
+    for (auto& destroyed : events.destroyed)
+    {
+        (destroyed.is_static ? static_ : dynamic_).remove(destroyed.slot);
+    }
+}
+
+bool SnapshotServer::update()
+{
+    TraceZone zone("Snapshot Server");
+    receive();
+
+    // Viewers that stopped acknowledging are dropped, so nothing is sent into the void
+    std::erase_if(viewers_,
+                  [](const Viewer& viewer)
+                  {
+                      if (viewer.last_heard.getElapsedTime() < VIEWER_TIMEOUT)
+                      {
+                          return false;
+                      }
+                      std::println("Viewer {}:{} timed out", viewer.address.toString(),
+                                   viewer.port);
+                      return true;
+                  });
+
+    if (statistics_clock_.getElapsedTime() >= sf::seconds(1.0f))
+    {
+        auto seconds = statistics_clock_.restart().asSeconds();
+        statistics_.bytes_per_second = static_cast<int>(static_cast<float>(bytes_sent_) / seconds);
+        statistics_.datagrams_per_second =
+            static_cast<int>(static_cast<float>(datagrams_sent_) / seconds);
+        bytes_sent_ = 0;
+        datagrams_sent_ = 0;
+    }
+    statistics_.viewers = static_cast<int>(viewers_.size());
+
+    auto interval = sf::seconds(1.0f / static_cast<float>(std::max(snapshot_rate, 1)));
+    if (viewers_.empty() || snapshot_clock_.getElapsedTime() < interval)
+    {
+        return false;
+    }
+    snapshot_clock_.restart();
+
+    sf::Clock clock;
+    statistics_.snapshot_bodies = 0;
+    statistics_.sent_bodies = 0;
+    for (auto& viewer : viewers_)
+    {
+        send_snapshot(viewer);
+    }
+    statistics_.serialize_time = clock.getElapsedTime();
+    return true;
+}
+
+const ServerStatistics& SnapshotServer::statistics() const
+{
+    return statistics_;
+}
+
+void SnapshotServer::BodySlots::add(std::uint32_t slot, const StepEvents::BodyCreated& created)
+{
+    if (slot >= transforms.size())
+    {
+        transforms.resize(slot + 1, b2Transform_identity);
+        radii.resize(slot + 1, 0.0f);
+        generations.resize(slot + 1, 0);
+        colours.resize(slot + 1);
+        polygons.resize(slot + 1);
+    }
+
+    float radius = 0.0f;
+    for (auto& polygon : created.polygons)
+    {
+        for (int i = 0; i < polygon.count; i++)
+        {
+            radius = std::max(radius, b2Length(polygon.vertices[i]) + polygon.radius);
+        }
+    }
+
+    transforms[slot] = created.transform;
+    radii[slot] = radius;
+    generations[slot]++;
+    colours[slot] = created.colour;
+    polygons[slot] = created.polygons;
+}
+
+void SnapshotServer::BodySlots::remove(std::uint32_t slot)
+{
+    // A negative radius is never in view
+    radii[slot] = -1.0f;
+    polygons[slot].clear();
+}
+
+void SnapshotServer::receive()
+{
+    std::array<std::uint8_t, MAX_DATAGRAM_SIZE> buffer;
+    std::size_t size = 0;
+    std::optional<sf::IpAddress> address;
+    unsigned short port = 0;
+    while (socket_.receive(buffer.data(), buffer.size(), size, address, port) ==
+           sf::Socket::Status::Done)
+    {
+        ByteReader reader({buffer.data(), size});
+        MessageType type;
+        b2AABB view_area;
+        if (!address || !read_header(reader, type))
+        {
+            continue;
+        }
+
+        auto viewer = std::ranges::find_if(
+            viewers_, [&](const Viewer& viewer)
+            { return viewer.address == *address && viewer.port == port; });
+        if (type == MessageType::Hello)
+        {
+            if (!reader.read(view_area.lowerBound) || !reader.read(view_area.upperBound))
+            {
+                continue;
+            }
+
+            // A viewer that restarted on the same port starts again from nothing
+            if (viewer == viewers_.end())
+            {
+                std::println("Viewer {}:{} connected", address->toString(), port);
+                viewer = viewers_.insert(viewers_.end(), {.address = *address, .port = port,
+                                                          .view_area = view_area});
+            }
+            viewer->acknowledged = 0;
+            viewer->view_area = view_area;
+            viewer->last_heard.restart();
+        }
+        else if (type == MessageType::Ack && viewer != viewers_.end())
+        {
+            std::uint32_t sequence;
+            if (!reader.read(sequence) || !reader.read(view_area.lowerBound) ||
+                !reader.read(view_area.upperBound))
+            {
+                continue;
+            }
+
+            // Acks can arrive out of order, and the baseline must be a snapshot that was sent
+            if (sequence > viewer->acknowledged && sequence < viewer->next_sequence)
+            {
+                viewer->acknowledged = sequence;
+            }
+            viewer->view_area = view_area;
+            viewer->last_heard.restart();
+        }
+    }
+}
+
+void SnapshotServer::send_snapshot(Viewer& viewer)
+{
+    auto sequence = viewer.next_sequence++;
+
+    // The acknowledged snapshot is the baseline while it is still kept, which it is not if the
+    // new snapshot is about to take its place
+    const NetworkSnapshot* baseline = &empty_;
+    auto& acknowledged = viewer.sent[viewer.acknowledged % SNAPSHOT_HISTORY];
+    if (viewer.acknowledged != 0 && sequence - viewer.acknowledged < SNAPSHOT_HISTORY &&
+        acknowledged.sequence == viewer.acknowledged)
+    {
+        baseline = &acknowledged;
+    }
+
+    gathered_.clear();
+    gather(dynamic_, 0, viewer.view_area, gathered_);
+    gather(static_, STATIC_BODY_ID, viewer.view_area, gathered_);
+    statistics_.snapshot_bodies += static_cast<int>(gathered_.size());
+
+    // The snapshot is what the viewer will have once it arrives, so a new body that did not fit in
+    // the budget is left out of it and a body whose shape did not fit keeps its old one
+    auto& snapshot = viewer.sent[sequence % SNAPSHOT_HISTORY];
+    snapshot.sequence = sequence;
+    snapshot.bodies.clear();
+    std::size_t new_body_bytes = 0;
+    auto send_full = [&](const NetworkBody& body)
+    {
+        write_full(body);
+        if (new_body_bytes + record_.size() > NEW_BODY_BUDGET)
+        {
+            return false;
+        }
+        new_body_bytes += record_.size();
+        append_record(body.id, sequence, baseline->sequence);
+        statistics_.sent_bodies++;
+        return true;
+    };
+
+    // Both lists are in order of id, so are merged to find what was added, removed and changed
+    fragments_.clear();
+    fragment_starts_.clear();
+    begin_fragment(sequence, baseline->sequence);
+    auto& bodies = gathered_;
+    auto& previous = baseline->bodies;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < bodies.size() || j < previous.size())
+    {
+        if (j == previous.size() || (i < bodies.size() && bodies[i].id < previous[j].id))
+        {
+            if (send_full(bodies[i]))
+            {
+                snapshot.bodies.push_back(bodies[i]);
+            }
+            i++;
+        }
+        else if (i == bodies.size() || previous[j].id < bodies[i].id)
+        {
+            record_.clear();
+            record_.write(static_cast<std::uint8_t>(BODY_REMOVED));
+            append_record(previous[j++].id, sequence, baseline->sequence);
+        }
+        else
+        {
+            // A body made in a reused slot has a new shape
+            if (bodies[i].generation != previous[j].generation)
+            {
+                snapshot.bodies.push_back(send_full(bodies[i]) ? bodies[i] : previous[j]);
+            }
+            else
+            {
+                if (bodies[i].x != previous[j].x || bodies[i].y != previous[j].y ||
+                    bodies[i].angle != previous[j].angle)
+                {
+                    write_changes(bodies[i], previous[j]);
+                    append_record(bodies[i].id, sequence, baseline->sequence);
+                    statistics_.sent_bodies++;
+                }
+                snapshot.bodies.push_back(bodies[i]);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    auto fragment_count = static_cast<std::uint16_t>(fragment_starts_.size());
+    fragment_starts_.push_back(fragments_.size());
+    for (std::size_t fragment = 0; fragment + 1 < fragment_starts_.size(); fragment++)
+    {
+        auto begin = fragment_starts_[fragment];
+        auto size = fragment_starts_[fragment + 1] - begin;
+        fragments_.patch(begin + FRAGMENT_COUNT_OFFSET, fragment_count);
+
+        // A datagram the socket can not take now is lost like any other
+        (void)socket_.send(fragments_.bytes().data() + begin, size, viewer.address, viewer.port);
+        bytes_sent_ += static_cast<int>(size);
+        datagrams_sent_++;
+    }
+}
+
+void SnapshotServer::gather(const BodySlots& slots, std::uint32_t id_bit, b2AABB area,
+                            std::vector<NetworkBody>& bodies) const
+{
+    area.lowerBound = b2Sub(area.lowerBound, {VIEW_MARGIN, VIEW_MARGIN});
+    area.upperBound = b2Add(area.upperBound, {VIEW_MARGIN, VIEW_MARGIN});
+    for (std::uint32_t slot = 0; slot < slots.transforms.size(); slot++)
+    {
+        auto position = slots.transforms[slot].p;
+        auto radius = slots.radii[slot];
+        if (radius >= 0.0f && position.x + radius >= area.lowerBound.x &&
+            position.x - radius <= area.upperBound.x && position.y + radius >= area.lowerBound.y &&
+            position.y - radius <= area.upperBound.y)
+        {
+            bodies.push_back(
+                quantize(slot | id_bit, slots.generations[slot], slots.transforms[slot]));
+        }
+    }
+}
+
+void SnapshotServer::write_full(const NetworkBody& body)
+{
+    auto& slots = (body.id & STATIC_BODY_ID) ? static_ : dynamic_;
+    auto slot = body.id & ~STATIC_BODY_ID;
+    auto colour = slots.colours[slot];
+
+    record_.clear();
+    record_.write(static_cast<std::uint8_t>(BODY_FULL));
+    record_.write_varint(body.generation);
+    record_.write_signed(body.x);
+    record_.write_signed(body.y);
+    record_.write(body.angle);
+    record_.write(colour.r);
+    record_.write(colour.g);
+    record_.write(colour.b);
+    record_.write(colour.a);
+    record_.write(static_cast<std::uint8_t>(slots.polygons[slot].size()));
+    for (auto& polygon : slots.polygons[slot])
+    {
+        record_.write(static_cast<std::uint8_t>(polygon.count));
+        for (int i = 0; i < polygon.count; i++)
+        {
+            record_.write(polygon.vertices[i]);
+        }
+    }
+}
+
+void SnapshotServer::write_changes(const NetworkBody& body, const NetworkBody& baseline)
+{
+    std::uint8_t flags = 0;
+    flags |= body.x != baseline.x ? BODY_X : 0;
+    flags |= body.y != baseline.y ? BODY_Y : 0;
+    flags |= body.angle != baseline.angle ? BODY_ANGLE : 0;
+
+    record_.clear();
+    record_.write(flags);
+    if (flags & BODY_X)
+    {
+        record_.write_signed(body.x - baseline.x);
+    }
+    if (flags & BODY_Y)
+    {
+        record_.write_signed(body.y - baseline.y);
+    }
+    if (flags & BODY_ANGLE)
+    {
+        // The shorter way around, as the angle wraps
+        record_.write_signed(static_cast<std::int16_t>(body.angle - baseline.angle));
+    }
+}
+
+void SnapshotServer::append_record(std::uint32_t id, std::uint32_t sequence,
+                                   std::uint32_t baseline)
+{
+    // Every fragment can be read on its own, so ids restart from 0 in each. A record too big for
+    // any fragment is sent in one of its own.
+    auto fragment_size = fragments_.size() - fragment_starts_.back();
+    if (fragment_size + MAX_VARINT_SIZE + record_.size() > MAX_DATAGRAM_SIZE &&
+        fragment_size > FRAGMENT_HEADER_SIZE)
+    {
+        begin_fragment(sequence, baseline);
+    }
+
+    fragments_.write_varint(id - previous_id_);
+    fragments_.write_bytes(record_.bytes());
+    previous_id_ = id;
+}
+
+void SnapshotServer::begin_fragment(std::uint32_t sequence, std::uint32_t baseline)
+{
+    fragment_starts_.push_back(fragments_.size());
+    previous_id_ = 0;
+    write_header(fragments_, MessageType::Snapshot);
+    fragments_.write(sequence);
+    fragments_.write(baseline);
+    fragments_.write(static_cast<std::uint16_t>(fragment_starts_.size() - 1));
+
+    // Patched once the snapshot has been split
+    fragments_.write(std::uint16_t{0});
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Network/IpAddress.hpp>
+#include <SFML/Network/UdpSocket.hpp>
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Time.hpp>
+#include <box2d/box2d.h>
+
+#include "../Physics/Simulation.h"
+#include "Protocol.h"
+
+/// What the server sent, over the last second
+struct ServerStatistics
+{
+    int viewers = 0;
+    int bytes_per_second = 0;
+    int datagrams_per_second = 0;
+
+    /// Bodies in the latest snapshots of every viewer, and how many of them had to be sent
+    int snapshot_bodies = 0;
+    int sent_bodies = 0;
+
+    /// Time taken to gather, diff and encode the latest snapshots
+    sf::Time serialize_time;
+};
+
+/// Streams the bodies of the simulation to viewers over UDP, see Protocol.h.
+///
+/// The server keeps its own copy of the bodies, updated from the simulation's step events, so it
+/// works the same whether the simulation runs on the physics thread or not. Each viewer is only
+/// sent the bodies around the area its camera can see, and only those that differ from the latest
+/// snapshot it acknowledged. Lost datagrams are never resent, the next snapshot is diffed against
+/// an older baseline instead. New bodies are spread over several snapshots when there are many, so
+/// a viewer that just connected is not sent one huge snapshot that is unlikely to arrive whole.
+class SnapshotServer
+{
+  public:
+    /// Binds the socket, printing the problem to std::cerr if it can not be bound
+    bool listen(unsigned short port);
+
+    /// Updates the server's copy of the bodies
+    void apply_events(const StepEvents& events);
+
+    /// Handles the viewers' messages and sends them snapshots when they are due, never blocking
+    /// @return Whether snapshots were sent
+    bool update();
+
+    const ServerStatistics& statistics() const;
+
+    /// Snapshots sent per second
+    int snapshot_rate = 30;
+
+  private:
+    /// The dynamic or the static bodies, by slot
+    struct BodySlots
+    {
+        std::vector<b2Transform> transforms;
+
+        /// How far the body reaches from its position, so bodies overlapping the view are sent
+        std::vector<float> radii;
+
+        /// Even when the slot is empty
+        std::vector<std::uint32_t> generations;
+        std::vector<sf::Color> colours;
+        std::vector<std::vector<b2Polygon>> polygons;
+
+        void add(std::uint32_t slot, const StepEvents::BodyCreated& created);
+        void remove(std::uint32_t slot);
+    };
+
+    struct Viewer
+    {
+        sf::IpAddress address;
+        unsigned short port;
+        b2AABB view_area;
+
+        /// The latest snapshot the viewer has, 0 if it has none
+        std::uint32_t acknowledged = 0;
+        std::uint32_t next_sequence = 1;
+        std::array<NetworkSnapshot, SNAPSHOT_HISTORY> sent{};
+        sf::Clock last_heard{};
+    };
+
+    void receive();
+    void send_snapshot(Viewer& viewer);
+
+    /// Adds the bodies of the slots overlapping the area to the snapshot, in order of id
+    void gather(const BodySlots& slots, std::uint32_t id_bit, b2AABB area,
+                std::vector<NetworkBody>& bodies) const;
+
+    // Records are written to record_ before it is known which fragment they fit in
+    void write_full(const NetworkBody& body);
+    void write_changes(const NetworkBody& body, const NetworkBody& baseline);
+    void append_record(std::uint32_t id, std::uint32_t sequence, std::uint32_t baseline);
+    void begin_fragment(std::uint32_t sequence, std::uint32_t baseline);
+
+    sf::UdpSocket socket_;
+    std::vector<Viewer> viewers_;
+
+    BodySlots dynamic_;
+    BodySlots static_;
+
+    /// The baseline of viewers that have no snapshot yet
+    NetworkSnapshot empty_;
+    std::vector<NetworkBody> gathered_;
+
+    // Every fragment of the snapshot being sent, one after another
+    ByteWriter fragments_;
+    std::vector<std::size_t> fragment_starts_;
+    ByteWriter record_;
+    std::uint32_t previous_id_ = 0;
+
+    sf::Clock snapshot_clock_;
+    sf::Clock statistics_clock_;
+    int bytes_sent_ = 0;
+    int datagrams_sent_ = 0;
+    ServerStatistics statistics_;
+};
@@ -0,0 +1,176 @@
+#include "Bodies.h"
+
+#include <algorithm>
+#include <cmath>
+
+b2Vec2 create_random_b2vec(Random& rng, float x_min, float x_max, float y_min, float y_max)
+{
+    // Generated into locals, as the order arguments are evaluated in is unspecified
+    auto x = rng.range(x_min, x_max);
+    auto y = rng.range(y_min, y_max);
+    return {x, y};
+}
+
+sf::Color random_colour(Random& rng)
+{
+    // constexpr static std::array<sf::Color, 7> COLOURS{
+    //     sf::Color::White,  sf::Color::Red,     sf::Color::Green, sf::Color::Blue,
+    //     sf::Color::Yellow, sf::Color::Magenta, sf::Color::Cyan,
+    // };
+    // One number has enough bits for all three channels
+    auto bits = rng.next();
+    return {
+        static_cast<std::uint8_t>(bits),
+        static_cast<std::uint8_t>(bits >> 8),
+        static_cast<std::uint8_t>(bits >> 16),
+    };
+}
+
+b2Vec2 half_extents(std::span<const b2Vec2> points)
+{
+    b2Vec2 lower = points[0];
+    b2Vec2 upper = points[0];
+    for (auto point : points)
+    {
+        lower = b2Min(lower, point);
+        upper = b2Max(upper, point);
+    }
+    return b2MulSV(0.5f, b2Sub(upper, lower));
+}
+
+BoxDefinition dynamic_box_definition()
+{
+    BoxDefinition definition{
+        .body = b2DefaultBodyDef(),
+        .shape = b2DefaultShapeDef(),
+        .polygon = b2MakeBox(DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE),
+    };
+    definition.body.type = b2_dynamicBody;
+
+    // As this example has no gravity, damping needs to be applied or objects will float and
+    // spin forever
+    definition.body.linearDamping = 1.0f;
+    definition.body.angularDamping = 1.0f;
+
+    definition.shape.density = 1.0f;
+    definition.shape.material.friction = 0.3f;
+    return definition;
+}
+
+BoxDefinition static_box_definition(b2Vec2 size)
+{
+    BoxDefinition definition{
+        .body = b2DefaultBodyDef(),
+        .shape = b2DefaultShapeDef(),
+        .polygon = b2MakeBox(size.x, size.y),
+    };
+    definition.body.type = b2_staticBody;
+    definition.shape.filter.categoryBits = STATIC_CATEGORY;
+    return definition;
+}
+
+b2BodyId create_box(b2WorldId world, BoxDefinition& definition, b2Vec2 position, b2Vec2 velocity)
+{
+    definition.body.position = position;
+    definition.body.linearVelocity = velocity;
+
+    b2BodyId body_id = b2CreateBody(world, &definition.body);
+    b2CreatePolygonShape(body_id, &definition.shape, &definition.polygon);
+    return body_id;
+}
+
+std::vector<b2Vec2> jittered_grid(b2WorldId world, b2AABB area, int count, Random& rng)
+{
+    // Boxes are created unrotated, so a small gap between cells is enough to keep them apart
+    constexpr float GAP = 0.5f;
+    constexpr float SPACING = DYNAMIC_BOX_SIZE * 2.0f + GAP;
+    constexpr float MAX_JITTER = GAP / 2.0f * 0.9f;
+
+    auto area_columns = static_cast<int>((area.upperBound.x - area.lowerBound.x) / SPACING);
+    auto square_columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+    auto columns = std::max({1, area_columns, square_columns});
+
+    auto filter = b2DefaultQueryFilter();
+    filter.maskBits = STATIC_CATEGORY;
+    auto found = [](b2ShapeId, void* context)
+    {
+        *static_cast<bool*>(context) = true;
+        return false;
+    };
+
+    std::vector<float> jitter(static_cast<std::size_t>(count) * 2);
+    rng.fill(jitter, -MAX_JITTER, MAX_JITTER);
+
+    std::vector<b2Vec2> positions;
+    positions.reserve(count);
+    for (int cell = 0; static_cast<int>(positions.size()) < count; cell++)
+    {
+        b2Vec2 centre = {
+            area.lowerBound.x + SPACING * (static_cast<float>(cell % columns) + 0.5f),
+            area.lowerBound.y + SPACING * (static_cast<float>(cell / columns) + 0.5f),
+        };
+
+        b2Vec2 extent = {SPACING / 2.0f, SPACING / 2.0f};
+        bool overlaps_static = false;
+        b2World_OverlapAABB(world, {b2Sub(centre, extent), b2Add(centre, extent)}, filter, found,
+                            &overlaps_static);
+        if (!overlaps_static)
+        {
+            auto i = positions.size() * 2;
+            positions.push_back(b2Add(centre, {jitter[i], jitter[i + 1]}));
+        }
+    }
+    return positions;
+}
+
+Box create_box(b2WorldId world, b2Vec2 position, sf::Color colour)
+{
+    auto definition = dynamic_box_definition();
+    b2BodyId body_id = create_box(world, definition, position);
+
+    return {
+        .size = {DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE},
+        .body = body_id,
+        .colour = colour,
+    };
+}
+
+Box create_static_box(b2WorldId world, b2Vec2 size, b2Vec2 position)
+{
+    auto definition = static_box_definition(size);
+    b2BodyId body_id = create_box(world, definition, position);
+
+    return {
+        .size = size,
+        .body = body_id,
+        .colour = sf::Color::Green,
+    };
+}
+
+PhysicsObject create_special(b2WorldId world, const std::vector<b2Vec2>& points, b2Vec2 position,
+                             sf::Color colour)
+{
+    b2BodyDef body = b2DefaultBodyDef();
+    body.type = b2_dynamicBody;
+    body.position = position;
+    body.linearDamping = 1.0f;
+    body.angularDamping = 1.0f;
+
+    b2ShapeDef shape = b2DefaultShapeDef();
+    shape.density = 1.0f;
+    shape.material.friction = 0.3f;
+
+    b2BodyId body_id = b2CreateBody(world, &body);
+    b2Hull hull = b2ComputeHull(points.data(), points.size());
+    b2Polygon polygon = b2MakePolygon(&hull, 0);
+    b2CreatePolygonShape(body_id, &shape, &polygon);
+
+    // b2Vec2 com = b2Body_GetLocalCenterOfMass(body_id);
+    //  object.shape.setOrigin({com.x * SCALE, com.y * SCALE});
+
+    return {
+        .body = body_id,
+        .polygon = polygon,
+        .colour = colour,
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <box2d/box2d.h>
+
+#include "../Util/Random.h"
+
+struct Box
+{
+    b2Vec2 size;
+    b2BodyId body;
+    sf::Color colour;
+};
+
+struct PhysicsObject
+{
+    b2BodyId body;
+    b2Polygon polygon;
+    sf::Color colour;
+};
+
+/// Collision category of the static geometry, so world queries can skip it
+constexpr std::uint64_t STATIC_CATEGORY = 0x2;
+
+/// Half the width of the dynamic boxes
+constexpr float DYNAMIC_BOX_SIZE = 1.0f;
+
+/// Points of the hull used for the special shape
+const std::vector<b2Vec2> SPECIAL_POINTS = {{-5.0f, 0.0f}, {5.0f, 0.0f}, {0.0f, 5.0f}};
+
+/// Creates a random vec2
+b2Vec2 create_random_b2vec(Random& rng, float x_min = 10.0f, float x_max = 50.0f,
+                           float y_min = 10.0f, float y_max = 50.0f);
+
+/// Generate a random colour
+sf::Color random_colour(Random& rng);
+
+/// Half the size of the bounding box of the points
+b2Vec2 half_extents(std::span<const b2Vec2> points);
+
+/// Places the dynamic boxes on a grid, each jittered within its cell so they do not line up
+/// perfectly but never start overlapping each other or the static bodies of the world.
+///
+/// Cells are filled row by row from the bottom of the area. The grid is made wider than the
+/// area when needed to keep it roughly square, and grows upwards past the area if the count
+/// does not fit.
+std::vector<b2Vec2> jittered_grid(b2WorldId world, b2AABB area, int count, Random& rng);
+
+/// Everything a dynamic box is created from, so it can be built once and reused for many boxes
+struct BoxDefinition
+{
+    b2BodyDef body;
+    b2ShapeDef shape;
+    b2Polygon polygon;
+};
+
+BoxDefinition dynamic_box_definition();
+
+/// The definition of the static boxes, which only collide with dynamic bodies
+BoxDefinition static_box_definition(b2Vec2 size);
+
+/// Creates a box from the definition, at the position and with the velocity
+b2BodyId create_box(b2WorldId world, BoxDefinition& definition, b2Vec2 position,
+                    b2Vec2 velocity = {0, 0});
+
+/// Creates a box that has physics applied to it
+Box create_box(b2WorldId world, b2Vec2 position, sf::Color colour);
+
+/// Create a box that does not move
+Box create_static_box(b2WorldId world, b2Vec2 size, b2Vec2 position);
+
+/// Creates a dynamic body from the convex hull of the points
+PhysicsObject create_special(b2WorldId world, const std::vector<b2Vec2>& points, b2Vec2 position,
+                             sf::Color colour);
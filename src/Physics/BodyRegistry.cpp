@@ -0,0 +1,153 @@
+#include "BodyRegistry.h"
+
+namespace
+{
+    void* to_user_data(std::uint32_t handle_index)
+    {
+        return reinterpret_cast<void*>(static_cast<std::uintptr_t>(handle_index));
+    }
+
+    std::uint32_t from_user_data(void* user_data)
+    {
+        return static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(user_data));
+    }
+} // namespace
+
+BodyHandle BodyRegistry::add(b2BodyId body, b2Vec2 half_extents, sf::Color colour, ShapeKind kind,
+                             std::uint32_t render_slot)
+{
+    std::uint32_t handle_index;
+    if (free_handles_.empty())
+    {
+        handle_index = static_cast<std::uint32_t>(sparse_.size());
+        sparse_.emplace_back();
+    }
+    else
+    {
+        handle_index = free_handles_.back();
+        free_handles_.pop_back();
+    }
+
+    auto& sparse = sparse_[handle_index];
+    sparse.index = static_cast<std::uint32_t>(bodies_.size());
+
+    bodies_.push_back(body);
+    half_extents_.push_back(half_extents);
+    colours_.push_back(colour);
+    kinds_.push_back(kind);
+    render_slots_.push_back(render_slot);
+    handle_indices_.push_back(handle_index);
+
+    b2Body_SetUserData(body, to_user_data(handle_index));
+    return {.index = handle_index, .generation = sparse.generation};
+}
+
+void BodyRegistry::remove(BodyHandle handle)
+{
+    if (!contains(handle))
+    {
+        return;
+    }
+
+    // Swap the last row into the removed one
+    auto index = sparse_[handle.index].index;
+    auto last = bodies_.size() - 1;
+    if (index != last)
+    {
+        bodies_[index] = bodies_[last];
+        half_extents_[index] = half_extents_[last];
+        colours_[index] = colours_[last];
+        kinds_[index] = kinds_[last];
+        render_slots_[index] = render_slots_[last];
+        handle_indices_[index] = handle_indices_[last];
+        sparse_[handle_indices_[index]].index = index;
+    }
+    bodies_.pop_back();
+    half_extents_.pop_back();
+    colours_.pop_back();
+    kinds_.pop_back();
+    render_slots_.pop_back();
+    handle_indices_.pop_back();
+
+    sparse_[handle.index].generation++;
+    free_handles_.push_back(handle.index);
+}
+
+bool BodyRegistry::contains(BodyHandle handle) const
+{
+    return handle.index < sparse_.size() && sparse_[handle.index].generation == handle.generation;
+}
+
+void BodyRegistry::reserve(std::size_t size)
+{
+    bodies_.reserve(size);
+    half_extents_.reserve(size);
+    colours_.reserve(size);
+    kinds_.reserve(size);
+    render_slots_.reserve(size);
+    handle_indices_.reserve(size);
+    sparse_.reserve(size);
+}
+
+std::size_t BodyRegistry::index_of(BodyHandle handle) const
+{
+    return sparse_[handle.index].index;
+}
+
+BodyHandle BodyRegistry::handle_from_user_data(void* user_data) const
+{
+    auto handle_index = from_user_data(user_data);
+    return {.index = handle_index, .generation = sparse_[handle_index].generation};
+}
+
+BodyHandle BodyRegistry::handle_at(std::size_t index) const
+{
+    auto handle_index = handle_indices_[index];
+    return {.index = handle_index, .generation = sparse_[handle_index].generation};
+}
+
+void BodyRegistry::replace_body(std::size_t index, b2BodyId body)
+{
+    bodies_[index] = body;
+    b2Body_SetUserData(body, to_user_data(handle_indices_[index]));
+}
+
+std::size_t BodyRegistry::size() const
+{
+    return bodies_.size();
+}
+
+bool BodyRegistry::empty() const
+{
+    return bodies_.empty();
+}
+
+std::size_t BodyRegistry::handle_capacity() const
+{
+    return sparse_.size();
+}
+
+std::span<const b2BodyId> BodyRegistry::bodies() const
+{
+    return bodies_;
+}
+
+std::span<const b2Vec2> BodyRegistry::half_extents() const
+{
+    return half_extents_;
+}
+
+std::span<const sf::Color> BodyRegistry::colours() const
+{
+    return colours_;
+}
+
+std::span<const ShapeKind> BodyRegistry::kinds() const
+{
+    return kinds_;
+}
+
+std::span<const std::uint32_t> BodyRegistry::render_slots() const
+{
+    return render_slots_;
+}
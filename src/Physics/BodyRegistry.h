@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <box2d/box2d.h>
+
+enum class ShapeKind : std::uint8_t
+{
+    StaticBox,
+    Box,
+
+    /// The convex hull of a set of points, like the special shape
+    Hull,
+};
+
+/// Refers to a body in a BodyRegistry. Handles stay valid while other bodies are added and
+/// removed, and the generation is bumped when the body is removed so stale handles are detected
+/// rather than referring to whichever body reuses the index.
+struct BodyHandle
+{
+    std::uint32_t index = ~std::uint32_t{0};
+    std::uint32_t generation = 0;
+
+    bool operator==(const BodyHandle&) const = default;
+};
+
+/// The bodies of the simulation, stored as a struct of arrays so passes over one property (e.g.
+/// every body id) only touch that property's memory.
+///
+/// The columns are dense: removing a body moves the last body into its place, so iterating never
+/// skips holes but a body's column index changes. Handles map to the current column index in
+/// O(1), and each body's user data holds its handle index so bodies found through Box2D (queries,
+/// events) map back to their row without searching.
+class BodyRegistry
+{
+  public:
+    /// Adds the body, setting its user data to link it back to the registry
+    /// @param render_slot Where the renderer keeps the body's vertices
+    BodyHandle add(b2BodyId body, b2Vec2 half_extents, sf::Color colour, ShapeKind kind,
+                   std::uint32_t render_slot);
+
+    /// Removes the body from the registry, but does not destroy it. Does nothing if the handle
+    /// is stale.
+    void remove(BodyHandle handle);
+
+    bool contains(BodyHandle handle) const;
+
+    /// Makes room for the number of bodies, so adding many at once does not reallocate
+    void reserve(std::size_t size);
+
+    /// The index of the body in the columns, the handle must be valid
+    std::size_t index_of(BodyHandle handle) const;
+
+    /// The handle of the body whose user data this is
+    BodyHandle handle_from_user_data(void* user_data) const;
+
+    /// The handle of the body at the index in the columns
+    BodyHandle handle_at(std::size_t index) const;
+
+    /// Points the row at a different Box2D body, e.g. when the body is copied into a new world
+    void replace_body(std::size_t index, b2BodyId body);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    /// Every handle index given out so far is below this, so it can size a lookup by handle index
+    std::size_t handle_capacity() const;
+
+    // Columns, all indexed the same way
+    std::span<const b2BodyId> bodies() const;
+    std::span<const b2Vec2> half_extents() const;
+    std::span<const sf::Color> colours() const;
+    std::span<const ShapeKind> kinds() const;
+    std::span<const std::uint32_t> render_slots() const;
+
+  private:
+    struct Sparse
+    {
+        /// Index in the columns while the body is alive
+        std::uint32_t index = 0;
+        std::uint32_t generation = 0;
+    };
+
+    // Columns
+    std::vector<b2BodyId> bodies_;
+    std::vector<b2Vec2> half_extents_;
+    std::vector<sf::Color> colours_;
+    std::vector<ShapeKind> kinds_;
+    std::vector<std::uint32_t> render_slots_;
+
+    /// The handle index of each row, so the handle of the moved body can be fixed up on removal
+    std::vector<std::uint32_t> handle_indices_;
+
+    /// Indexed by handle index
+    std::vector<Sparse> sparse_;
+    std::vector<std::uint32_t> free_handles_;
+};
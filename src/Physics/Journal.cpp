@@ -0,0 +1,437 @@
+#include "Journal.h"
+
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <print>
+
+#include "../Util/ByteBuffer.h"
+#include "SceneFile.h"
+
+namespace
+{
+    constexpr std::array<char, 4> MAGIC = {'B', '2', 'J', 'R'};
+    constexpr std::uint32_t VERSION = 2;
+
+    /// Identifies each entry in the file, followed by the step and the entry's values
+    enum class EntryType : std::uint8_t
+    {
+        Explode,
+        SetGravity,
+        SetWorkerCount,
+        Reset,
+        SetBoxCount,
+        SetEmitter,
+        ReloadScene,
+        StepRate,
+
+        /// Ends the file, followed by the number of steps recorded
+        End,
+    };
+
+    void write_entry(ByteWriter& writer, const Journal::Entry& entry);
+
+    /// Reads the values of an entry of the type
+    /// @return The entry's action, or nothing if the type is unknown or the file ends early
+    std::optional<std::variant<Command, StepRate>> read_action(ByteReader& reader, EntryType type);
+
+    // Whether the values can be given to the simulation and Box2D, which a damaged file can have
+    // made anything
+    bool is_valid_scene(const SceneSettings& scene);
+    bool is_valid_action(const std::variant<Command, StepRate>& action);
+} // namespace
+
+Journal::Journal(const SceneSettings& scene, int worker_count)
+    : scene_(scene)
+    , worker_count_(worker_count)
+{
+}
+
+std::optional<Journal> Journal::load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::println(std::cerr, "Failed to open journal '{}'.", path);
+        return {};
+    }
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(file), {}};
+    ByteReader reader(bytes);
+
+    std::array<char, 4> magic;
+    std::uint32_t version = 0;
+    if (!reader.read_bytes(std::span(magic)) || magic != MAGIC || !reader.read(version) ||
+        version != VERSION)
+    {
+        std::println(std::cerr, "'{}' is not a journal, or is from another version.", path);
+        return {};
+    }
+
+    SceneSettings scene;
+    int worker_count = 0;
+    if (!reader.read(scene.gravity) || !reader.read(scene.box_count) ||
+        !reader.read(scene.static_box_count) || !reader.read(scene.seed) ||
+        !reader.read(scene.build_batch) || !reader.read(worker_count))
+    {
+        std::println(std::cerr, "Journal '{}' ends before its scene settings.", path);
+        return {};
+    }
+    if (!is_valid_scene(scene))
+    {
+        std::println(std::cerr, "Journal '{}' has invalid scene settings.", path);
+        return {};
+    }
+
+    std::uint32_t path_length = 0;
+    bool has_path = reader.read(path_length) && reader.remaining() >= path_length;
+    std::string scene_file_path(has_path ? path_length : 0, '\0');
+    std::uint64_t scene_file_hash = 0;
+    if (!has_path || !reader.read_bytes(std::span(scene_file_path)) ||
+        !reader.read(scene_file_hash))
+    {
+        std::println(std::cerr, "Journal '{}' ends before its scene file.", path);
+        return {};
+    }
+
+    Journal journal(scene, worker_count);
+    journal.scene_file_path_ = std::move(scene_file_path);
+    journal.scene_file_hash_ = scene_file_hash;
+    while (true)
+    {
+        EntryType type;
+        std::uint64_t step = 0;
+        if (!reader.read(type) || !reader.read(step))
+        {
+            std::println(std::cerr, "Journal '{}' ends early.", path);
+            return {};
+        }
+
+        if (type == EntryType::End)
+        {
+            journal.step_count_ = step;
+            return journal;
+        }
+
+        auto action = read_action(reader, type);
+        if (!action || !is_valid_action(*action))
+        {
+            std::println(std::cerr, "Journal '{}' has an invalid entry at step {}.", path, step);
+            return {};
+        }
+        journal.entries_.push_back({.step = step, .action = *action});
+    }
+}
+
+bool Journal::save(const std::string& path) const
+{
+    ByteWriter writer;
+    writer.write_bytes(std::span(MAGIC));
+    writer.write(VERSION);
+
+    writer.write(scene_.gravity);
+    writer.write(scene_.box_count);
+    writer.write(scene_.static_box_count);
+    writer.write(scene_.seed);
+    writer.write(scene_.build_batch);
+    writer.write(worker_count_);
+    writer.write(static_cast<std::uint32_t>(scene_file_path_.size()));
+    writer.write_bytes(std::span(scene_file_path_));
+    writer.write(scene_file_hash_);
+
+    for (auto& entry : entries_)
+    {
+        write_entry(writer, entry);
+    }
+    writer.write(EntryType::End);
+    writer.write(step_count_);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(writer.bytes().data()),
+               static_cast<std::streamsize>(writer.size()));
+    if (!file)
+    {
+        std::println(std::cerr, "Failed to write journal '{}'.", path);
+        return false;
+    }
+    return true;
+}
+
+void Journal::set_scene_file(const std::string& path, const SceneFile& scene_file)
+{
+    scene_file_path_ = path;
+    scene_file_hash_ = scene_file.content_hash();
+}
+
+bool Journal::check_scene_file(const SceneFile* scene_file) const
+{
+    if (scene_file_path_.empty() != (scene_file == nullptr))
+    {
+        std::println(std::cerr, "The journal was recorded in {}, so can not be replayed in {}.",
+                     scene_file ? "a generated scene" : "a scene file",
+                     scene_file ? "a scene file" : "a generated scene");
+        return false;
+    }
+    if (scene_file && scene_file->content_hash() != scene_file_hash_)
+    {
+        std::println(std::cerr, "The scene file '{}' has changed since the journal was recorded.",
+                     scene_file_path_);
+        return false;
+    }
+    return true;
+}
+
+void Journal::record(std::uint64_t step, const Command& command)
+{
+    // A reloaded binary file is read in place, so it is copied before the file can change again
+    if (auto reload_scene = std::get_if<ReloadSceneCommand>(&command))
+    {
+        auto& file = *reload_scene->file;
+        auto copy = std::make_shared<SceneFile>();
+        copy->open_records("the reloaded scene", file.gravity(),
+                           {file.bodies().begin(), file.bodies().end()},
+                           {file.vertices().begin(), file.vertices().end()});
+        entries_.push_back({.step = step, .action = ReloadSceneCommand{std::move(copy)}});
+        return;
+    }
+    entries_.push_back({.step = step, .action = command});
+}
+
+void Journal::record_step(std::uint64_t step, StepRate rate)
+{
+    if (rate != rate_)
+    {
+        rate_ = rate;
+        entries_.push_back({.step = step, .action = rate});
+    }
+    step_count_ = step + 1;
+}
+
+const SceneSettings& Journal::scene() const
+{
+    return scene_;
+}
+
+const std::string& Journal::scene_file_path() const
+{
+    return scene_file_path_;
+}
+
+int Journal::worker_count() const
+{
+    return worker_count_;
+}
+
+std::span<const Journal::Entry> Journal::entries() const
+{
+    return entries_;
+}
+
+std::uint64_t Journal::step_count() const
+{
+    return step_count_;
+}
+
+namespace
+{
+    void write_entry(ByteWriter& writer, const Journal::Entry& entry)
+    {
+        if (auto rate = std::get_if<StepRate>(&entry.action))
+        {
+            writer.write(EntryType::StepRate);
+            writer.write(entry.step);
+            writer.write(rate->timestep);
+            writer.write(rate->sub_steps);
+            return;
+        }
+
+        auto& command = std::get<Command>(entry.action);
+        if (auto explode = std::get_if<ExplodeCommand>(&command))
+        {
+            writer.write(EntryType::Explode);
+            writer.write(entry.step);
+            writer.write(explode->position);
+            writer.write(explode->radius);
+            writer.write(explode->falloff);
+            writer.write(explode->impulse_per_length);
+        }
+        else if (auto set_gravity = std::get_if<SetGravityCommand>(&command))
+        {
+            writer.write(EntryType::SetGravity);
+            writer.write(entry.step);
+            writer.write(set_gravity->gravity);
+        }
+        else if (auto set_workers = std::get_if<SetWorkerCountCommand>(&command))
+        {
+            writer.write(EntryType::SetWorkerCount);
+            writer.write(entry.step);
+            writer.write(set_workers->worker_count);
+        }
+        else if (std::holds_alternative<ResetCommand>(command))
+        {
+            writer.write(EntryType::Reset);
+            writer.write(entry.step);
+        }
+        else if (auto set_box_count = std::get_if<SetBoxCountCommand>(&command))
+        {
+            writer.write(EntryType::SetBoxCount);
+            writer.write(entry.step);
+            writer.write(set_box_count->box_count);
+        }
+        else if (auto set_emitter = std::get_if<SetEmitterCommand>(&command))
+        {
+            writer.write(EntryType::SetEmitter);
+            writer.write(entry.step);
+            writer.write(static_cast<std::uint8_t>(set_emitter->enabled));
+            writer.write(set_emitter->rate);
+            writer.write(set_emitter->position);
+        }
+        else if (auto reload_scene = std::get_if<ReloadSceneCommand>(&command))
+        {
+            auto& file = *reload_scene->file;
+            auto bodies = file.bodies();
+            auto vertices = file.vertices();
+            writer.write(EntryType::ReloadScene);
+            writer.write(entry.step);
+            writer.write(file.gravity());
+            writer.write(static_cast<std::uint32_t>(bodies.size()));
+            writer.write(static_cast<std::uint32_t>(vertices.size()));
+            writer.write_bytes(bodies);
+            writer.write_bytes(vertices);
+        }
+    }
+
+    std::optional<std::variant<Command, StepRate>> read_action(ByteReader& reader, EntryType type)
+    {
+        switch (type)
+        {
+            case EntryType::Explode:
+            {
+                ExplodeCommand explode;
+                if (reader.read(explode.position) && reader.read(explode.radius) &&
+                    reader.read(explode.falloff) && reader.read(explode.impulse_per_length))
+                {
+                    return Command{explode};
+                }
+                break;
+            }
+            case EntryType::SetGravity:
+            {
+                SetGravityCommand set_gravity;
+                if (reader.read(set_gravity.gravity))
+                {
+                    return Command{set_gravity};
+                }
+                break;
+            }
+            case EntryType::SetWorkerCount:
+            {
+                SetWorkerCountCommand set_workers;
+                if (reader.read(set_workers.worker_count))
+                {
+                    return Command{set_workers};
+                }
+                break;
+            }
+            case EntryType::Reset:
+                return Command{ResetCommand{}};
+            case EntryType::SetBoxCount:
+            {
+                SetBoxCountCommand set_box_count;
+                if (reader.read(set_box_count.box_count))
+                {
+                    return Command{set_box_count};
+                }
+                break;
+            }
+            case EntryType::SetEmitter:
+            {
+                SetEmitterCommand set_emitter;
+                std::uint8_t enabled = 0;
+                if (reader.read(enabled) && reader.read(set_emitter.rate) &&
+                    reader.read(set_emitter.position))
+                {
+                    set_emitter.enabled = enabled != 0;
+                    return Command{set_emitter};
+                }
+                break;
+            }
+            case EntryType::ReloadScene:
+            {
+                b2Vec2 gravity;
+                std::uint32_t body_count = 0;
+                std::uint32_t vertex_count = 0;
+                if (!reader.read(gravity) || !reader.read(body_count) ||
+                    !reader.read(vertex_count) ||
+                    reader.remaining() < std::size_t{body_count} * sizeof(SceneBody) +
+                                             std::size_t{vertex_count} * sizeof(b2Vec2))
+                {
+                    break;
+                }
+
+                std::vector<SceneBody> bodies(body_count);
+                std::vector<b2Vec2> vertices(vertex_count);
+                reader.read_bytes(std::span(bodies));
+                reader.read_bytes(std::span(vertices));
+                auto file = std::make_shared<SceneFile>();
+                if (file->open_records("the journal's reload", gravity, std::move(bodies),
+                                       std::move(vertices)))
+                {
+                    return Command{ReloadSceneCommand{std::move(file)}};
+                }
+                break;
+            }
+            case EntryType::StepRate:
+            {
+                StepRate rate;
+                if (reader.read(rate.timestep) && reader.read(rate.sub_steps))
+                {
+                    return rate;
+                }
+                break;
+            }
+            case EntryType::End:
+                break;
+        }
+        return {};
+    }
+
+    bool is_valid_scene(const SceneSettings& scene)
+    {
+        return b2IsValidVec2(scene.gravity) && scene.box_count >= 0 &&
+               scene.static_box_count >= 0 && scene.build_batch >= 0;
+    }
+
+    bool is_valid_action(const std::variant<Command, StepRate>& action)
+    {
+        if (auto rate = std::get_if<StepRate>(&action))
+        {
+            return b2IsValidFloat(rate->timestep) && rate->timestep > 0 && rate->sub_steps > 0;
+        }
+
+        auto& command = std::get<Command>(action);
+        if (auto explode = std::get_if<ExplodeCommand>(&command))
+        {
+            return b2IsValidVec2(explode->position) && b2IsValidFloat(explode->radius) &&
+                   b2IsValidFloat(explode->falloff) &&
+                   b2IsValidFloat(explode->impulse_per_length) && explode->radius >= 0 &&
+                   explode->falloff >= 0;
+        }
+        if (auto set_gravity = std::get_if<SetGravityCommand>(&command))
+        {
+            return b2IsValidVec2(set_gravity->gravity);
+        }
+        if (auto set_box_count = std::get_if<SetBoxCountCommand>(&command))
+        {
+            return set_box_count->box_count >= 0;
+        }
+        if (auto set_emitter = std::get_if<SetEmitterCommand>(&command))
+        {
+            return b2IsValidFloat(set_emitter->rate) && set_emitter->rate >= 0 &&
+                   b2IsValidVec2(set_emitter->position);
+        }
+
+        // Worker counts are clamped by the scheduler, and reloaded scenes were checked as they
+        // were read
+        return true;
+    }
+} // namespace
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Simulation.h"
+
+class SceneFile;
+
+/// The length of a step and how many sub-steps it is split into
+struct StepRate
+{
+    float timestep;
+    int sub_steps;
+
+    bool operator==(const StepRate&) const = default;
+};
+
+/// Everything that changed a simulation: the commands executed on it and the rate it was stepped
+/// at, each against the number of steps that had run when it happened. Along with the settings
+/// the scene was built from, and the scene file it was loaded from if any, this is enough to
+/// replay a session step for step.
+///
+/// A scene file is only named and hashed, so it must not change before the journal is replayed.
+/// Reloads of it are written whole, as the file will have changed again by then.
+///
+/// Saved as a compact binary file, so a recorded session can be replayed later as a repeatable
+/// performance test.
+class Journal
+{
+  public:
+    struct Entry
+    {
+        /// The number of steps run before this happened
+        std::uint64_t step;
+        std::variant<Command, StepRate> action;
+    };
+
+    Journal(const SceneSettings& scene, int worker_count);
+
+    /// Reads a journal written by save, printing the problem to std::cerr if it can not be read
+    static std::optional<Journal> load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    /// Records that the scene was loaded from the file rather than generated
+    void set_scene_file(const std::string& path, const SceneFile& scene_file);
+
+    /// Checks the scene is the one the journal was recorded in, printing the problem to std::cerr
+    /// if it is not
+    /// @param scene_file The file the scene is loaded from, or null if it is generated
+    bool check_scene_file(const SceneFile* scene_file) const;
+
+    void record(std::uint64_t step, const Command& command);
+
+    /// Called before each step, only recording the rate when it changes
+    void record_step(std::uint64_t step, StepRate rate);
+
+    const SceneSettings& scene() const;
+
+    /// The scene file the journal was recorded in, empty if the scene was generated
+    const std::string& scene_file_path() const;
+    int worker_count() const;
+    std::span<const Entry> entries() const;
+
+    /// The number of steps that were run while recording
+    std::uint64_t step_count() const;
+
+  private:
+    SceneSettings scene_;
+    std::string scene_file_path_;
+    std::uint64_t scene_file_hash_ = 0;
+    int worker_count_;
+    std::vector<Entry> entries_;
+    std::optional<StepRate> rate_;
+    std::uint64_t step_count_ = 0;
+};
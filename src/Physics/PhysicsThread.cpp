@@ -0,0 +1,162 @@
+#include "PhysicsThread.h"
+
+#include <cmath>
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/System/Sleep.hpp>
+
+#include "../Util/Trace.h"
+
+namespace
+{
+    /// The most steps that can run in one update before time is dropped
+    constexpr int MAX_STEPS_PER_UPDATE = 8;
+
+    /// Stop stepping when this many steps are waiting for the render thread, so the physics does
+    /// not run away from a render thread that has stalled (e.g. while the window is dragged)
+    constexpr std::size_t MAX_UNACKNOWLEDGED_STEPS = 64;
+} // namespace
+
+PhysicsThread::PhysicsThread(Simulation& simulation)
+    : simulation_(simulation)
+{
+}
+
+PhysicsThread::~PhysicsThread()
+{
+    stop();
+}
+
+void PhysicsThread::start()
+{
+    if (!is_running())
+    {
+        unacknowledged_.clear();
+        thread_ = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+    }
+}
+
+void PhysicsThread::stop()
+{
+    if (thread_.joinable())
+    {
+        thread_.request_stop();
+        thread_.join();
+
+        // Commands pushed since the thread's last update would otherwise wait for the next start
+        std::vector<Command> commands;
+        {
+            std::lock_guard lock(command_mutex_);
+            std::swap(commands, commands_);
+        }
+        for (auto& command : commands)
+        {
+            simulation_.execute(command);
+        }
+    }
+}
+
+bool PhysicsThread::is_running() const
+{
+    return thread_.joinable();
+}
+
+void PhysicsThread::set_rate(int physics_rate, int sub_steps)
+{
+    physics_rate_ = physics_rate;
+    sub_steps_ = sub_steps;
+}
+
+void PhysicsThread::push_command(Command command)
+{
+    std::lock_guard lock(command_mutex_);
+    commands_.push_back(std::move(command));
+}
+
+void PhysicsThread::set_view_area(b2AABB area)
+{
+    std::lock_guard lock(command_mutex_);
+    view_area_ = area;
+}
+
+const PhysicsSnapshot* PhysicsThread::consume()
+{
+    return snapshots_.consume() ? &snapshots_.front() : nullptr;
+}
+
+void PhysicsThread::acknowledge(std::uint64_t step)
+{
+    acknowledged_step_.store(step, std::memory_order_release);
+}
+
+void PhysicsThread::run(std::stop_token stop_token)
+{
+    Trace::set_thread_name("Physics");
+
+    // Counters only count the thread that opens them
+    PerfCounters counters;
+
+    std::vector<Command> commands;
+    b2AABB view_area;
+
+    sf::Clock clock;
+    auto accumulator = 0.0f;
+    while (!stop_token.stop_requested())
+    {
+        {
+            std::lock_guard lock(command_mutex_);
+            std::swap(commands, commands_);
+            view_area = view_area_;
+        }
+        for (auto& command : commands)
+        {
+            simulation_.execute(command);
+        }
+        commands.clear();
+
+        auto timestep = 1.0f / static_cast<float>(physics_rate_.load());
+        accumulator += clock.restart().asSeconds();
+        if (accumulator < timestep)
+        {
+            sf::sleep(sf::seconds(timestep - accumulator));
+            continue;
+        }
+
+        auto acknowledged = acknowledged_step_.load(std::memory_order_acquire);
+        while (!unacknowledged_.empty() && unacknowledged_.front().step <= acknowledged)
+        {
+            unacknowledged_.pop_front();
+        }
+        if (unacknowledged_.size() >= MAX_UNACKNOWLEDGED_STEPS)
+        {
+            accumulator = 0.0f;
+            sf::sleep(sf::seconds(timestep));
+            continue;
+        }
+
+        TraceZone zone("Physics Update");
+        sf::Clock step_clock;
+        auto start_counters = counters.read();
+        auto steps = 0;
+        auto sub_steps = sub_steps_.load();
+        while (accumulator >= timestep && steps < MAX_STEPS_PER_UPDATE)
+        {
+            simulation_.step(timestep, sub_steps);
+            unacknowledged_.push_back(simulation_.take_events());
+            accumulator -= timestep;
+            steps++;
+        }
+        accumulator = std::fmod(accumulator, timestep);
+        auto step_time = step_clock.getElapsedTime();
+        auto step_counters = counters.read() - start_counters;
+
+        auto& snapshot = snapshots_.back();
+        snapshot.events.assign(unacknowledged_.begin(), unacknowledged_.end());
+        simulation_.find_visible(view_area, snapshot.visible);
+        snapshot.step_time = step_time / static_cast<float>(steps);
+        snapshot.steps = steps;
+        snapshot.step_counters = step_counters / static_cast<std::uint64_t>(steps);
+        snapshot.statistics = simulation_.step_statistics();
+        snapshots_.publish();
+    }
+}
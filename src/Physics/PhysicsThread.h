@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SFML/System/Time.hpp>
+
+#include "../Util/PerfCounters.h"
+#include "../Util/TripleBuffer.h"
+#include "Simulation.h"
+
+/// What the physics thread publishes to the render thread after each update
+struct PhysicsSnapshot
+{
+    /// The events of every step the render thread has not acknowledged yet, oldest first. Steps
+    /// can be in more than one snapshot, so steps already applied must be skipped.
+    std::vector<StepEvents> events;
+
+    /// Slots of the dynamic bodies overlapping the view area at the latest step
+    std::vector<std::uint32_t> visible;
+
+    /// Average time of one step, and how many steps ran in the update
+    sf::Time step_time;
+    int steps = 0;
+
+    /// Average hardware counters of one step on the physics thread, zero if not available
+    PerfSample step_counters;
+
+    /// Box2D's breakdown of the latest step
+    StepStatistics statistics;
+};
+
+/// Runs a simulation on its own thread at a fixed rate, so stepping the world and rendering it
+/// happen at the same time rather than one after the other.
+///
+/// While running the thread owns the simulation: the world is only changed through commands and
+/// only read through the published snapshots.
+class PhysicsThread
+{
+  public:
+    explicit PhysicsThread(Simulation& simulation);
+    ~PhysicsThread();
+
+    PhysicsThread(const PhysicsThread&) = delete;
+    PhysicsThread& operator=(const PhysicsThread&) = delete;
+
+    void start();
+
+    /// Waits for the thread to finish its current update, after which the simulation can be used
+    /// directly again. Commands still queued are executed on the calling thread, and their events
+    /// are left in the simulation to be taken.
+    void stop();
+    bool is_running() const;
+
+    void set_rate(int physics_rate, int sub_steps);
+
+    /// Queues a command to be executed before the next step
+    void push_command(Command command);
+
+    /// Sets the area used to find the visible bodies
+    void set_view_area(b2AABB area);
+
+    /// Takes the latest snapshot if one has been published since the last call, never blocking
+    const PhysicsSnapshot* consume();
+
+    /// Tells the physics thread the events up to and including this step have been applied, so
+    /// they no longer need to be included in snapshots
+    void acknowledge(std::uint64_t step);
+
+  private:
+    void run(std::stop_token stop_token);
+
+    Simulation& simulation_;
+    std::jthread thread_;
+
+    std::atomic<int> physics_rate_ = 60;
+    std::atomic<int> sub_steps_ = 4;
+
+    // Render -> physics
+    std::mutex command_mutex_;
+    std::vector<Command> commands_;
+    b2AABB view_area_{};
+
+    // Physics -> render
+    TripleBuffer<PhysicsSnapshot> snapshots_;
+    std::atomic<std::uint64_t> acknowledged_step_ = 0;
+
+    /// Events published but not yet acknowledged, only touched by the physics thread
+    std::deque<StepEvents> unacknowledged_;
+};
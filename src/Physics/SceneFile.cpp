@@ -0,0 +1,373 @@
+#include "SceneFile.h"
+
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <print>
+#include <vector>
+
+#include "../Util/ByteBuffer.h"
+#include "../Util/TextScanner.h"
+#include "Simulation.h"
+
+namespace
+{
+    constexpr std::array<char, 4> MAGIC = {'B', '2', 'S', 'C'};
+    constexpr std::uint32_t VERSION = 1;
+
+    struct Header
+    {
+        std::array<char, 4> magic;
+        std::uint32_t version;
+        b2Vec2 gravity;
+        std::uint32_t body_count;
+        std::uint32_t box_count;
+        std::uint32_t vertex_count;
+
+        /// Keeps the arrays after the header 8 byte aligned
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(Header) == 32 && std::is_trivially_copyable_v<Header>);
+
+    /// Whether Box2D can be given the body's position, rotation, velocities and size, which a
+    /// hand edited or truncated binary file can have made anything
+    bool is_valid_body(const SceneBody& body);
+
+    /// Whether the hull's vertices make a polygon Box2D can use
+    bool is_valid_hull(std::span<const b2Vec2> vertices);
+} // namespace
+
+bool SceneFile::open(const std::string& path)
+{
+    if (!file_.open(path))
+    {
+        return false;
+    }
+
+    auto bytes = file_.bytes();
+    bool is_binary = bytes.size() >= MAGIC.size() &&
+                     std::memcmp(bytes.data(), MAGIC.data(), MAGIC.size()) == 0;
+    if (is_binary ? !read_binary(path) : !parse_text(path))
+    {
+        return false;
+    }
+    return check_bodies(path);
+}
+
+bool SceneFile::open_records(const std::string& name, b2Vec2 gravity,
+                             std::vector<SceneBody> bodies, std::vector<b2Vec2> vertices)
+{
+    file_.close();
+    parsed_bodies_ = std::move(bodies);
+    parsed_vertices_ = std::move(vertices);
+    bodies_ = parsed_bodies_;
+    vertices_ = parsed_vertices_;
+    gravity_ = gravity;
+    return check_bodies(name);
+}
+
+bool SceneFile::read_binary(const std::string& path)
+{
+    auto bytes = file_.bytes();
+
+    Header header;
+    if (bytes.size() < sizeof(Header))
+    {
+        std::println(std::cerr, "'{}' is not a scene file.", path);
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(Header));
+    if (header.version != VERSION)
+    {
+        std::println(std::cerr, "Scene file '{}' is from another version.", path);
+        return false;
+    }
+
+    auto bodies_size = std::size_t{header.body_count} * sizeof(SceneBody);
+    auto vertices_size = std::size_t{header.vertex_count} * sizeof(b2Vec2);
+    if (bytes.size() != sizeof(Header) + bodies_size + vertices_size)
+    {
+        std::println(std::cerr, "Scene file '{}' is the wrong size for its {} bodies.", path,
+                     header.body_count);
+        return false;
+    }
+
+    // The file is mapped at the start of a page and the header keeps the arrays aligned
+    bodies_ = {reinterpret_cast<const SceneBody*>(bytes.data() + sizeof(Header)),
+               header.body_count};
+    vertices_ = {reinterpret_cast<const b2Vec2*>(bytes.data() + sizeof(Header) + bodies_size),
+                 header.vertex_count};
+    gravity_ = header.gravity;
+    return true;
+}
+
+bool SceneFile::parse_text(const std::string& path)
+{
+    auto bytes = file_.bytes();
+    TextScanner scanner({reinterpret_cast<const char*>(bytes.data()), bytes.size()});
+    auto error = [&](std::string_view message)
+    {
+        std::println(std::cerr, "{}:{}: {}", path, scanner.line_number(), message);
+        return false;
+    };
+
+    gravity_ = {0, -20.0f};
+    std::array<std::uint8_t, 4> colour = {255, 255, 255, 255};
+    while (scanner.next_line())
+    {
+        auto keyword = scanner.next_token();
+        if (keyword == "gravity")
+        {
+            if (!scanner.next_number(gravity_.x) || !scanner.next_number(gravity_.y))
+            {
+                return error("Expected 'gravity <x> <y>'.");
+            }
+        }
+        else if (keyword == "colour")
+        {
+            colour[3] = 255;
+            if (!scanner.next_number(colour[0]) || !scanner.next_number(colour[1]) ||
+                !scanner.next_number(colour[2]) ||
+                (!scanner.at_line_end() && !scanner.next_number(colour[3])))
+            {
+                return error("Expected 'colour <r> <g> <b> [a]', from 0 to 255.");
+            }
+        }
+        else if (keyword == "static" || keyword == "box" || keyword == "hull")
+        {
+            SceneBody body{
+                .position = {0, 0},
+                .rotation = b2Rot_identity,
+                .linear_velocity = {0, 0},
+                .angular_velocity = 0,
+                .half_extents = {DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE},
+                .colour = colour,
+                .kind = ShapeKind::Box,
+                .awake = 1,
+                .hull_vertex_count = 0,
+                .first_hull_vertex = static_cast<std::uint32_t>(parsed_vertices_.size()),
+            };
+            if (!scanner.next_number(body.position.x) || !scanner.next_number(body.position.y))
+            {
+                return error("Expected the position of the body.");
+            }
+
+            float angle = 0;
+            if (keyword == "static")
+            {
+                body.kind = ShapeKind::StaticBox;
+                if (!scanner.next_number(body.half_extents.x) ||
+                    !scanner.next_number(body.half_extents.y) || body.half_extents.x <= 0 ||
+                    body.half_extents.y <= 0)
+                {
+                    return error("Expected 'static <x> <y> <half width> <half height> [angle]'.");
+                }
+            }
+            else if (keyword == "hull")
+            {
+                body.kind = ShapeKind::Hull;
+                while (!scanner.at_line_end())
+                {
+                    b2Vec2 vertex;
+                    if (!scanner.next_number(vertex.x) || !scanner.next_number(vertex.y))
+                    {
+                        return error("Expected 'hull <x> <y> <x1> <y1> <x2> <y2> <x3> <y3> ...'.");
+                    }
+                    parsed_vertices_.push_back(vertex);
+                }
+                auto count = parsed_vertices_.size() - body.first_hull_vertex;
+                if (count < 3 || count > B2_MAX_POLYGON_VERTICES)
+                {
+                    return error(std::format("A hull needs 3 to {} vertices.",
+                                             B2_MAX_POLYGON_VERTICES));
+                }
+                body.hull_vertex_count = static_cast<std::uint16_t>(count);
+                body.half_extents =
+                    half_extents(std::span(parsed_vertices_).subspan(body.first_hull_vertex));
+            }
+
+            if (body.kind != ShapeKind::Hull && !scanner.at_line_end())
+            {
+                if (!scanner.next_number(angle))
+                {
+                    return error("Expected the angle of the body in degrees.");
+                }
+                body.rotation = b2MakeRot(angle * B2_PI / 180.0f);
+            }
+            parsed_bodies_.push_back(body);
+        }
+        else
+        {
+            return error(std::format("Unknown keyword '{}'.", keyword));
+        }
+
+        if (!scanner.at_line_end())
+        {
+            return error("Unexpected values at the end of the line.");
+        }
+    }
+
+    // Everything has been copied out of the text
+    file_.close();
+    bodies_ = parsed_bodies_;
+    vertices_ = parsed_vertices_;
+    return true;
+}
+
+bool SceneFile::check_bodies(const std::string& path)
+{
+    std::uint32_t box_count = 0;
+    for (auto& body : bodies_)
+    {
+        bool valid = is_valid_body(body);
+        switch (body.kind)
+        {
+            case ShapeKind::StaticBox:
+                break;
+            case ShapeKind::Box:
+                box_count++;
+                break;
+            case ShapeKind::Hull:
+                valid = valid &&
+                        std::size_t{body.first_hull_vertex} + body.hull_vertex_count <=
+                            vertices_.size() &&
+                        is_valid_hull(hull(body));
+                break;
+            default:
+                valid = false;
+                break;
+        }
+
+        if (!valid)
+        {
+            std::println(std::cerr, "Scene file '{}' has an invalid body {}.", path,
+                         &body - bodies_.data());
+            return false;
+        }
+    }
+    box_count_ = static_cast<int>(box_count);
+    return true;
+}
+
+bool SceneFile::save(const Simulation& simulation, const std::string& path)
+{
+    auto& registry = simulation.registry();
+    auto bodies = registry.bodies();
+
+    std::vector<SceneBody> records;
+    std::vector<b2Vec2> vertices;
+    records.reserve(bodies.size());
+    std::uint32_t box_count = 0;
+    for (std::size_t i = 0; i < bodies.size(); i++)
+    {
+        auto body = bodies[i];
+        auto colour = registry.colours()[i];
+        auto kind = registry.kinds()[i];
+        auto transform = b2Body_GetTransform(body);
+        SceneBody record{
+            .position = transform.p,
+            .rotation = transform.q,
+            .linear_velocity = b2Body_GetLinearVelocity(body),
+            .angular_velocity = b2Body_GetAngularVelocity(body),
+            .half_extents = registry.half_extents()[i],
+            .colour = {colour.r, colour.g, colour.b, colour.a},
+            .kind = kind,
+            .awake = b2Body_IsAwake(body),
+            .hull_vertex_count = 0,
+            .first_hull_vertex = static_cast<std::uint32_t>(vertices.size()),
+        };
+
+        if (kind == ShapeKind::Box)
+        {
+            box_count++;
+        }
+        else if (kind == ShapeKind::Hull)
+        {
+            b2ShapeId shape;
+            if (b2Body_GetShapes(body, &shape, 1) == 1 && b2Shape_GetType(shape) == b2_polygonShape)
+            {
+                auto polygon = b2Shape_GetPolygon(shape);
+                vertices.insert(vertices.end(), polygon.vertices, polygon.vertices + polygon.count);
+                record.hull_vertex_count = static_cast<std::uint16_t>(polygon.count);
+            }
+        }
+        records.push_back(record);
+    }
+
+    Header header{
+        .magic = MAGIC,
+        .version = VERSION,
+        .gravity = b2World_GetGravity(simulation.world()),
+        .body_count = static_cast<std::uint32_t>(records.size()),
+        .box_count = box_count,
+        .vertex_count = static_cast<std::uint32_t>(vertices.size()),
+        .reserved = 0,
+    };
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()),
+               static_cast<std::streamsize>(records.size() * sizeof(SceneBody)));
+    file.write(reinterpret_cast<const char*>(vertices.data()),
+               static_cast<std::streamsize>(vertices.size() * sizeof(b2Vec2)));
+    if (!file)
+    {
+        std::println(std::cerr, "Failed to write scene file '{}'.", path);
+        return false;
+    }
+    return true;
+}
+
+b2Vec2 SceneFile::gravity() const
+{
+    return gravity_;
+}
+
+int SceneFile::box_count() const
+{
+    return box_count_;
+}
+
+std::span<const SceneBody> SceneFile::bodies() const
+{
+    return bodies_;
+}
+
+std::span<const b2Vec2> SceneFile::hull(const SceneBody& body) const
+{
+    return vertices_.subspan(body.first_hull_vertex, body.hull_vertex_count);
+}
+
+std::span<const b2Vec2> SceneFile::vertices() const
+{
+    return vertices_;
+}
+
+std::uint64_t SceneFile::content_hash() const
+{
+    // The records have no padding, so hash the same however they were read
+    auto hash = hash_bytes(std::as_bytes(std::span(&gravity_, 1)));
+    hash = hash_bytes(std::as_bytes(bodies_), hash);
+    return hash_bytes(std::as_bytes(vertices_), hash);
+}
+
+namespace
+{
+    bool is_valid_body(const SceneBody& body)
+    {
+        return b2IsValidVec2(body.position) && b2IsValidRotation(body.rotation) &&
+               b2IsValidVec2(body.linear_velocity) && b2IsValidFloat(body.angular_velocity) &&
+               b2IsValidVec2(body.half_extents) && body.half_extents.x > 0 &&
+               body.half_extents.y > 0;
+    }
+
+    bool is_valid_hull(std::span<const b2Vec2> vertices)
+    {
+        if (vertices.size() < 3 || vertices.size() > B2_MAX_POLYGON_VERTICES)
+        {
+            return false;
+        }
+        return b2ComputeHull(vertices.data(), static_cast<int>(vertices.size())).count > 0;
+    }
+} // namespace
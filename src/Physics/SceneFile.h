@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <box2d/box2d.h>
+
+#include "../Util/MappedFile.h"
+#include "BodyRegistry.h"
+
+class Simulation;
+
+/// A body as it is stored in a scene file
+struct SceneBody
+{
+    b2Vec2 position;
+    b2Rot rotation;
+    b2Vec2 linear_velocity;
+    float angular_velocity;
+    b2Vec2 half_extents;
+
+    /// Red, green, blue and alpha
+    std::array<std::uint8_t, 4> colour;
+    ShapeKind kind;
+    std::uint8_t awake;
+
+    /// The hull's vertices, relative to the body, in the file's vertex array. Boxes have none as
+    /// they are made from the half extents.
+    std::uint16_t hull_vertex_count;
+    std::uint32_t first_hull_vertex;
+};
+
+// The bodies are read in place, so must be laid out the same on every platform
+static_assert(sizeof(SceneBody) == 48 && std::is_trivially_copyable_v<SceneBody>);
+
+/// The bodies of a scene, loaded from a file rather than generated.
+///
+/// Binary files are saved from a running scene, so a large scene can be loaded again without
+/// generating it and shared between benchmark runs. They are a header, then an array of
+/// SceneBody, then an array of the hull vertices, with every value little endian. The file is
+/// memory mapped and the arrays are used in place, so opening it only checks the records rather
+/// than parsing them into another buffer.
+///
+/// Text files are written by hand, one body per line:
+///
+///     # Comments start with '#'
+///     gravity 0 -20
+///     colour 255 128 0                # Of the bodies on the following lines
+///     static <x> <y> <half width> <half height> [angle]
+///     box <x> <y> [angle]
+///     hull <x> <y> <x1> <y1> <x2> <y2> <x3> <y3> ...
+///
+/// Angles are in degrees and hull vertices are relative to the body. The text is tokenized in
+/// place and parsed into the same records as the binary format, in one pass. The whole file is
+/// parsed before any body is created, so a parse error never leaves a scene half built.
+class SceneFile
+{
+  public:
+    /// Maps and checks the file, binary or text, printing the problem to std::cerr if it can not
+    /// be used
+    /// @return Whether the file was opened
+    bool open(const std::string& path);
+
+    /// Uses records read from somewhere other than a scene file, such as a journal, checking them
+    /// as open does
+    /// @param name What the records are called in the problems printed to std::cerr
+    bool open_records(const std::string& name, b2Vec2 gravity, std::vector<SceneBody> bodies,
+                      std::vector<b2Vec2> vertices);
+
+    /// Writes the simulation's bodies as they are now
+    static bool save(const Simulation& simulation, const std::string& path);
+
+    b2Vec2 gravity() const;
+
+    /// The number of dynamic boxes, as opposed to the static boxes and hulls
+    int box_count() const;
+
+    std::span<const SceneBody> bodies() const;
+
+    /// The vertices of the body's hull, relative to the body
+    std::span<const b2Vec2> hull(const SceneBody& body) const;
+
+    /// The vertices of every hull, which the bodies index into
+    std::span<const b2Vec2> vertices() const;
+
+    /// Identifies the scene by its gravity and records, so the same scene saved as text or binary
+    /// hashes the same. Reads every record, so is only meant to be called once.
+    std::uint64_t content_hash() const;
+
+  private:
+    /// Points the arrays at the mapped file
+    bool read_binary(const std::string& path);
+
+    /// Parses the mapped file into parsed_bodies_ and parsed_vertices_
+    bool parse_text(const std::string& path);
+
+    /// Checks the records, so building the scene never has to
+    bool check_bodies(const std::string& path);
+
+    MappedFile file_;
+
+    /// The records of a text file
+    std::vector<SceneBody> parsed_bodies_;
+    std::vector<b2Vec2> parsed_vertices_;
+
+    b2Vec2 gravity_{};
+    int box_count_ = 0;
+    std::span<const SceneBody> bodies_;
+    std::span<const b2Vec2> vertices_;
+};
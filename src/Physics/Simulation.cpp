@@ -0,0 +1,955 @@
+#include "Simulation.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include <SFML/System/Clock.hpp>
+
+#include "../Util/ByteBuffer.h"
+#include "../Util/Trace.h"
+#include "Journal.h"
+#include "SceneFile.h"
+
+namespace
+{
+    /// Bodies are destroyed when they leave this area, e.g. after being blown away by an explosion.
+    /// It grows to cover the scene when the scene is bigger.
+    constexpr b2AABB WORLD_BOUNDS = {.lowerBound = {-100, -100}, .upperBound = {250, 250}};
+
+    /// Inside the walls, where the scene's boxes are placed
+    constexpr b2AABB BOX_AREA = {.lowerBound = {3, 3}, .upperBound = {121, 89}};
+
+    /// The most boxes spawned in one step, so a large increase in the box count is spread over
+    /// several steps rather than stalling one
+    constexpr int MAX_SPAWNS_PER_STEP = 2000;
+
+    /// The context of the b2World_OverlapAABB query for the visible bodies
+    struct VisibleQuery
+    {
+        const BodyRegistry& registry;
+        std::vector<std::uint32_t>& slots;
+    };
+
+    b2WorldId create_world(b2Vec2 gravity, TaskScheduler& scheduler);
+
+    /// Creates a copy of the body in another world, with the same shapes, velocity and user data
+    b2BodyId copy_body(b2WorldId world, b2BodyId body);
+
+    /// Gets the polygon shapes of a body, relative to the body
+    std::vector<b2Polygon> get_polygons(b2BodyId body);
+
+    /// Gets the shape of a body made by the simulation, which all have a single polygon
+    b2Polygon get_polygon(b2BodyId body);
+
+    /// b2World_OverlapAABB callback that adds the slot of each shape's body to the VisibleQuery
+    /// given as the context
+    bool collect_slot(b2ShapeId shape, void* context);
+
+    bool contains(b2AABB area, b2Vec2 point);
+
+    float to_milliseconds(sf::Time time);
+
+    /// The area covering both, with a margin around the points
+    b2AABB expand(b2AABB area, std::span<const b2Vec2> points, float margin);
+
+    /// Creates the special shape at a random position
+    PhysicsObject create_random_special(b2WorldId world, Random& rng);
+
+    // Compare the bodies of scene files, either as a whole or only the parts that can not be
+    // changed in place (kind, size and colour)
+    std::size_t hash_record(const SceneBody& body, std::span<const b2Vec2> hull);
+    bool same_record(const SceneBody& a, std::span<const b2Vec2> a_hull, const SceneBody& b,
+                     std::span<const b2Vec2> b_hull);
+    std::size_t hash_shape(const SceneBody& body, std::span<const b2Vec2> hull);
+    bool same_shape(const SceneBody& a, std::span<const b2Vec2> a_hull, const SceneBody& b,
+                    std::span<const b2Vec2> b_hull);
+} // namespace
+
+Simulation::Simulation(const SceneSettings& settings, TaskScheduler& scheduler,
+                       const SceneFile* file)
+    : scheduler_(scheduler)
+    , world_(create_world(file ? file->gravity() : settings.gravity, scheduler))
+    , rng_(settings.seed)
+    , box_definition_(dynamic_box_definition())
+    , target_box_count_(file ? file->box_count() : settings.box_count)
+    , build_batch_(file ? 0 : settings.build_batch)
+    , world_bounds_(WORLD_BOUNDS)
+{
+    if (file)
+    {
+        load(*file);
+        return;
+    }
+
+    // Create static boxes
+    std::vector<Box> static_boxes = {
+        create_static_box(world_, {60, 1}, {61, 2}),
+        create_static_box(world_, {1, 40}, {2, 43}),
+        create_static_box(world_, {60, 1}, {61, 90}),
+    };
+
+    for (int i = 0; i < settings.static_box_count; i++)
+    {
+        static_boxes.push_back(
+            create_static_box(world_, {2, 2}, create_random_b2vec(rng_, 20, 70, 20, 50)));
+    }
+
+    for (auto& box : static_boxes)
+    {
+        add_body(box.body, box.size, box.colour, ShapeKind::StaticBox);
+    }
+
+    // Dynamic boxes are placed in cells around the static boxes, so none start overlapping and
+    // the first steps are not spent pushing them apart
+    placements_ = jittered_grid(world_, BOX_AREA, settings.box_count, rng_);
+    world_bounds_ = expand(WORLD_BOUNDS, placements_, 100.0f);
+
+    auto body_count = static_cast<std::size_t>(settings.box_count + settings.static_box_count + 4);
+    registry_.reserve(body_count);
+    events_.created.reserve(body_count);
+    if (build_batch_ <= 0)
+    {
+        spawn_boxes(settings.box_count);
+    }
+
+    auto special = create_random_special(world_, rng_);
+    std::span<const b2Vec2> hull(special.polygon.vertices,
+                                 static_cast<std::size_t>(special.polygon.count));
+    add_body(special.body, half_extents(hull), special.colour, ShapeKind::Hull);
+}
+
+Simulation::~Simulation()
+{
+    // Destroys the bodies along with it
+    b2DestroyWorld(world_);
+}
+
+void Simulation::execute(const Command& command)
+{
+    if (recording_)
+    {
+        recording_->record(step_count_, command);
+    }
+
+    if (auto explode = std::get_if<ExplodeCommand>(&command))
+    {
+        // Box2D finds the bodies in range through the broadphase, so only those are touched
+        b2ExplosionDef explosion = b2DefaultExplosionDef();
+        explosion.maskBits &= ~STATIC_CATEGORY;
+        explosion.position = explode->position;
+        explosion.radius = explode->radius;
+        explosion.falloff = explode->falloff;
+        explosion.impulsePerLength = explode->impulse_per_length;
+        b2World_Explode(world_, &explosion);
+    }
+    else if (auto set_gravity = std::get_if<SetGravityCommand>(&command))
+    {
+        b2World_SetGravity(world_, set_gravity->gravity);
+    }
+    else if (auto set_workers = std::get_if<SetWorkerCountCommand>(&command))
+    {
+        set_worker_count(set_workers->worker_count);
+    }
+    else if (auto set_box_count = std::get_if<SetBoxCountCommand>(&command))
+    {
+        target_box_count_ = std::max(0, set_box_count->box_count);
+    }
+    else if (auto set_emitter = std::get_if<SetEmitterCommand>(&command))
+    {
+        emitter_ = *set_emitter;
+    }
+    else if (auto reload_scene = std::get_if<ReloadSceneCommand>(&command))
+    {
+        reload(*reload_scene->file);
+    }
+    else if (std::holds_alternative<ResetCommand>(command))
+    {
+        // Until the scene is built it is still as it started
+        if (reset_checkpoint_)
+        {
+            restore(*reset_checkpoint_);
+        }
+    }
+}
+
+void Simulation::step(float timestep, int sub_steps)
+{
+    TraceZone zone("Simulation Step");
+    if (replaying_)
+    {
+        replay_entries(timestep, sub_steps);
+    }
+    if (recording_)
+    {
+        recording_->record_step(step_count_, {.timestep = timestep, .sub_steps = sub_steps});
+    }
+
+    spawning_ = {};
+    spawn_boxes(spawn_count(timestep));
+    if (!reset_checkpoint_ && placements_.empty())
+    {
+        reset_checkpoint_ = checkpoint();
+    }
+
+    b2World_Step(world_, timestep, sub_steps);
+    step_count_++;
+
+    // Only bodies that moved are reported, so sleeping bodies are never touched, and only they
+    // can have left the world bounds
+    auto events = b2World_GetBodyEvents(world_);
+    for (int i = 0; i < events.moveCount; i++)
+    {
+        auto& event = events.moveEvents[i];
+        events_.moved.push_back({
+            .slot = slot_from_user_data(event.userData),
+            .transform = event.transform,
+            .teleported = false,
+        });
+
+        if (!contains(world_bounds_, event.transform.p))
+        {
+            out_of_bounds_.push_back(registry_.handle_from_user_data(event.userData));
+        }
+    }
+
+    retire_bodies();
+}
+
+void Simulation::record(Journal* journal)
+{
+    recording_ = journal;
+}
+
+void Simulation::replay(const Journal& journal)
+{
+    replaying_ = &journal;
+    replay_cursor_ = 0;
+    replay_timestep_ = 0.0f;
+    replay_sub_steps_ = 0;
+}
+
+bool Simulation::is_replaying() const
+{
+    return replaying_ != nullptr;
+}
+
+StepEvents Simulation::take_events()
+{
+    // Whoever takes the events will have freed these slots once they are applied
+    free_dynamic_slots_.insert(free_dynamic_slots_.end(), pending_free_slots_.begin(),
+                               pending_free_slots_.end());
+    pending_free_slots_.clear();
+
+    events_.step = step_count_;
+    return std::exchange(events_, {});
+}
+
+void Simulation::find_visible(b2AABB area, std::vector<std::uint32_t>& slots) const
+{
+    auto filter = b2DefaultQueryFilter();
+    filter.maskBits &= ~STATIC_CATEGORY;
+
+    slots.clear();
+    VisibleQuery query{.registry = registry_, .slots = slots};
+    b2World_OverlapAABB(world_, area, filter, &collect_slot, &query);
+}
+
+StepStatistics Simulation::step_statistics() const
+{
+    return {
+        .profile = b2World_GetProfile(world_),
+        .counters = b2World_GetCounters(world_),
+        .awake_body_count = b2World_GetAwakeBodyCount(world_),
+        .spawning = spawning_,
+        .reload = reload_statistics_,
+    };
+}
+
+void Simulation::destroy_body(BodyHandle handle)
+{
+    if (!registry_.contains(handle))
+    {
+        return;
+    }
+
+    auto index = registry_.index_of(handle);
+    auto slot = registry_.render_slots()[index];
+    bool is_static = registry_.kinds()[index] == ShapeKind::StaticBox;
+    events_.destroyed.push_back({.slot = slot, .is_static = is_static});
+    if (!is_static)
+    {
+        pending_free_slots_.push_back(slot);
+    }
+
+    if (registry_.kinds()[index] == ShapeKind::Box)
+    {
+        box_count_--;
+    }
+
+    b2DestroyBody(registry_.bodies()[index]);
+    registry_.remove(handle);
+}
+
+Checkpoint Simulation::checkpoint() const
+{
+    TraceZone zone("Checkpoint");
+    Checkpoint checkpoint;
+    checkpoint.rng = rng_;
+    checkpoint.emit_accumulator = emit_accumulator_;
+
+    auto bodies = registry_.bodies();
+    checkpoint.bodies.reserve(bodies.size());
+    for (std::size_t i = 0; i < bodies.size(); i++)
+    {
+        auto body = bodies[i];
+        checkpoint.bodies.push_back({
+            .handle = registry_.handle_at(i),
+            .transform = b2Body_GetTransform(body),
+            .linear_velocity = b2Body_GetLinearVelocity(body),
+            .angular_velocity = b2Body_GetAngularVelocity(body),
+            .half_extents = registry_.half_extents()[i],
+            .polygon = get_polygon(body),
+            .colour = registry_.colours()[i],
+            .kind = registry_.kinds()[i],
+            .awake = b2Body_IsAwake(body),
+        });
+    }
+
+    // The rows are the same as the registry's, so the handles map to their index in bodies
+    checkpoint.spawn_order.reserve(spawn_order_.size());
+    for (auto handle : spawn_order_)
+    {
+        if (registry_.contains(handle))
+        {
+            auto row = registry_.index_of(handle);
+            checkpoint.spawn_order.push_back(static_cast<std::uint32_t>(row));
+        }
+    }
+    return checkpoint;
+}
+
+void Simulation::restore(Checkpoint& checkpoint)
+{
+    TraceZone zone("Restore Checkpoint");
+
+    // Destroy the bodies created since the checkpoint. Removing a row moves the last row into it,
+    // so going backwards only moves rows that have already been checked.
+    std::vector<std::uint8_t> in_checkpoint(registry_.handle_capacity(), 0);
+    for (auto& state : checkpoint.bodies)
+    {
+        if (registry_.contains(state.handle))
+        {
+            in_checkpoint[state.handle.index] = 1;
+        }
+    }
+    for (auto i = registry_.size(); i-- > 0;)
+    {
+        auto handle = registry_.handle_at(i);
+        if (!in_checkpoint[handle.index])
+        {
+            destroy_body(handle);
+        }
+    }
+
+    box_count_ = 0;
+    for (auto& state : checkpoint.bodies)
+    {
+        if (!registry_.contains(state.handle))
+        {
+            state.handle = recreate_body(state);
+        }
+
+        if (state.kind == ShapeKind::StaticBox)
+        {
+            continue;
+        }
+        if (state.kind == ShapeKind::Box)
+        {
+            box_count_++;
+        }
+
+        auto index = registry_.index_of(state.handle);
+        auto body = registry_.bodies()[index];
+        b2Body_SetTransform(body, state.transform.p, state.transform.q);
+        b2Body_SetLinearVelocity(body, state.linear_velocity);
+        b2Body_SetAngularVelocity(body, state.angular_velocity);
+        if (!state.awake)
+        {
+            b2Body_SetAwake(body, false);
+        }
+
+        // Teleporting a sleeping body does not create a move event
+        events_.moved.push_back({
+            .slot = registry_.render_slots()[index],
+            .transform = state.transform,
+            .teleported = true,
+        });
+    }
+
+    spawn_order_.clear();
+    for (auto row : checkpoint.spawn_order)
+    {
+        spawn_order_.push_back(checkpoint.bodies[row].handle);
+    }
+    rng_ = checkpoint.rng;
+    emit_accumulator_ = checkpoint.emit_accumulator;
+}
+
+b2WorldId Simulation::world() const
+{
+    return world_;
+}
+
+std::uint64_t Simulation::step_count() const
+{
+    return step_count_;
+}
+
+const BodyRegistry& Simulation::registry() const
+{
+    return registry_;
+}
+
+void Simulation::load(const SceneFile& file)
+{
+    TraceZone zone("Load Scene");
+    auto bodies = file.bodies();
+    registry_.reserve(bodies.size());
+    events_.created.reserve(bodies.size());
+
+    SceneDefinitions definitions{
+        .dynamic = box_definition_,
+        .fixed = static_box_definition({1, 1}),
+    };
+    std::vector<BodyHandle> handles;
+    handles.reserve(bodies.size());
+    for (auto& body : bodies)
+    {
+        handles.push_back(create_scene_body(body, file.hull(body), definitions));
+    }
+    remember_scene(file, handles);
+}
+
+void Simulation::reload(const SceneFile& file)
+{
+    TraceZone zone("Reload Scene");
+    sf::Clock clock;
+    b2World_SetGravity(world_, file.gravity());
+    target_box_count_ = file.box_count();
+
+    auto bodies = file.bodies();
+    std::vector<BodyHandle> handles(bodies.size());
+    std::vector<std::uint8_t> matched(bodies.size(), 0);
+    std::vector<std::uint8_t> old_used(scene_bodies_.size(), 0);
+    auto old_hull = [&](const SceneBody& body)
+    {
+        return std::span<const b2Vec2>(scene_vertices_)
+            .subspan(body.first_hull_vertex, body.hull_vertex_count);
+    };
+
+    // Bodies whose lines did not change are left alone, wherever they have moved to since. They
+    // are found by hashing the whole record, so lines that were only moved within the file match.
+    std::unordered_map<std::size_t, std::vector<std::uint32_t>> old_by_record;
+    for (std::uint32_t i = 0; i < scene_bodies_.size(); i++)
+    {
+        old_by_record[hash_record(scene_bodies_[i], old_hull(scene_bodies_[i]))].push_back(i);
+    }
+    int unchanged = 0;
+    for (std::size_t j = 0; j < bodies.size(); j++)
+    {
+        auto found = old_by_record.find(hash_record(bodies[j], file.hull(bodies[j])));
+        if (found == old_by_record.end())
+        {
+            continue;
+        }
+        for (auto i : found->second)
+        {
+            if (!old_used[i] && registry_.contains(scene_handles_[i]) &&
+                same_record(scene_bodies_[i], old_hull(scene_bodies_[i]), bodies[j],
+                            file.hull(bodies[j])))
+            {
+                old_used[i] = 1;
+                matched[j] = 1;
+                handles[j] = scene_handles_[i];
+                unchanged++;
+                break;
+            }
+        }
+    }
+
+    // The rest of the old dynamic bodies are paired in order with new bodies of the same shape and
+    // colour, which are moved in place. Static bodies are recreated, as the static geometry is
+    // built once per body.
+    std::unordered_map<std::size_t, std::deque<std::uint32_t>> old_by_shape;
+    for (std::uint32_t i = 0; i < scene_bodies_.size(); i++)
+    {
+        if (!old_used[i] && scene_bodies_[i].kind != ShapeKind::StaticBox)
+        {
+            old_by_shape[hash_shape(scene_bodies_[i], old_hull(scene_bodies_[i]))].push_back(i);
+        }
+    }
+
+    SceneDefinitions definitions{
+        .dynamic = box_definition_,
+        .fixed = static_box_definition({1, 1}),
+    };
+    int moved = 0;
+    int added = 0;
+    for (std::size_t j = 0; j < bodies.size(); j++)
+    {
+        if (matched[j])
+        {
+            continue;
+        }
+
+        auto& body = bodies[j];
+        auto hull = file.hull(body);
+        auto found = old_by_shape.find(hash_shape(body, hull));
+        while (found != old_by_shape.end() && !found->second.empty())
+        {
+            auto i = found->second.front();
+            found->second.pop_front();
+            if (!same_shape(scene_bodies_[i], old_hull(scene_bodies_[i]), body, hull) ||
+                !registry_.contains(scene_handles_[i]))
+            {
+                continue;
+            }
+
+            old_used[i] = 1;
+            matched[j] = 1;
+            handles[j] = scene_handles_[i];
+            teleport(handles[j], body);
+            moved++;
+            break;
+        }
+
+        if (!matched[j])
+        {
+            handles[j] = create_scene_body(body, hull, definitions);
+            added++;
+        }
+    }
+
+    int removed = 0;
+    for (std::size_t i = 0; i < scene_bodies_.size(); i++)
+    {
+        if (!old_used[i])
+        {
+            destroy_body(scene_handles_[i]);
+            removed++;
+        }
+    }
+
+    remember_scene(file, handles);
+
+    // Reset goes back to the scene as it is now
+    reset_checkpoint_.reset();
+
+    reload_statistics_ = {
+        .reloads = reload_statistics_.reloads + 1,
+        .unchanged = unchanged,
+        .moved = moved,
+        .added = added,
+        .removed = removed,
+        .time = to_milliseconds(clock.getElapsedTime()),
+    };
+}
+
+BodyHandle Simulation::create_scene_body(const SceneBody& body, std::span<const b2Vec2> hull,
+                                         SceneDefinitions& definitions)
+{
+    // Only the transforms, velocities and shapes differ, so the definitions are made once. Hulls
+    // are made like the boxes, as is the special shape.
+    auto& definition = body.kind == ShapeKind::StaticBox ? definitions.fixed : definitions.dynamic;
+    definition.body.position = body.position;
+    definition.body.rotation = body.rotation;
+    definition.body.linearVelocity = body.linear_velocity;
+    definition.body.angularVelocity = body.angular_velocity;
+    definition.body.isAwake = body.awake != 0;
+    auto id = b2CreateBody(world_, &definition.body);
+
+    b2Polygon polygon;
+    if (body.kind == ShapeKind::Hull)
+    {
+        // The file checked the hull is valid when it was opened
+        auto computed = b2ComputeHull(hull.data(), static_cast<int>(hull.size()));
+        polygon = b2MakePolygon(&computed, 0);
+    }
+    else
+    {
+        polygon = b2MakeBox(body.half_extents.x, body.half_extents.y);
+    }
+    b2CreatePolygonShape(id, &definition.shape, &polygon);
+
+    sf::Color colour{body.colour[0], body.colour[1], body.colour[2], body.colour[3]};
+    auto handle = add_body(id, body.half_extents, colour, body.kind, {&polygon, 1});
+    if (body.kind == ShapeKind::Box)
+    {
+        spawn_order_.push_back(handle);
+        box_count_++;
+    }
+    world_bounds_ = expand(world_bounds_, {&body.position, 1}, 100.0f);
+    return handle;
+}
+
+void Simulation::teleport(BodyHandle handle, const SceneBody& body)
+{
+    auto index = registry_.index_of(handle);
+    auto id = registry_.bodies()[index];
+    b2Body_SetTransform(id, body.position, body.rotation);
+    b2Body_SetLinearVelocity(id, body.linear_velocity);
+    b2Body_SetAngularVelocity(id, body.angular_velocity);
+    b2Body_SetAwake(id, body.awake != 0);
+
+    events_.moved.push_back({
+        .slot = registry_.render_slots()[index],
+        .transform = {body.position, body.rotation},
+        .teleported = true,
+    });
+    world_bounds_ = expand(world_bounds_, {&body.position, 1}, 100.0f);
+}
+
+void Simulation::remember_scene(const SceneFile& file, std::span<const BodyHandle> handles)
+{
+    auto bodies = file.bodies();
+    scene_bodies_.assign(bodies.begin(), bodies.end());
+    scene_handles_.assign(handles.begin(), handles.end());
+
+    // The hulls are copied out, as the file is closed once the scene is built
+    scene_vertices_.clear();
+    for (auto& body : scene_bodies_)
+    {
+        auto hull = file.hull(body);
+        body.first_hull_vertex = static_cast<std::uint32_t>(scene_vertices_.size());
+        scene_vertices_.insert(scene_vertices_.end(), hull.begin(), hull.end());
+    }
+}
+
+BodyHandle Simulation::add_body(b2BodyId body, b2Vec2 half_extents, sf::Color colour,
+                                ShapeKind kind, std::span<const b2Polygon> polygons)
+{
+    bool is_static = kind == ShapeKind::StaticBox;
+    std::uint32_t slot;
+    if (is_static)
+    {
+        slot = next_static_slot_++;
+    }
+    else if (!free_dynamic_slots_.empty())
+    {
+        slot = free_dynamic_slots_.back();
+        free_dynamic_slots_.pop_back();
+    }
+    else
+    {
+        slot = next_dynamic_slot_++;
+    }
+    auto handle = registry_.add(body, half_extents, colour, kind, slot);
+
+    events_.created.push_back({
+        .slot = slot,
+        .is_static = is_static,
+        .polygons = polygons.empty() ? get_polygons(body)
+                                     : std::vector<b2Polygon>(polygons.begin(), polygons.end()),
+        .transform = b2Body_GetTransform(body),
+        .colour = colour,
+        .move_index = events_.moved.size(),
+    });
+    return handle;
+}
+
+BodyHandle Simulation::recreate_body(const Checkpoint::BodyState& state)
+{
+    // Hulls are made like the dynamic boxes, as they are when loaded from a scene file
+    auto definition = state.kind == ShapeKind::StaticBox
+                          ? static_box_definition(state.half_extents)
+                          : box_definition_;
+    definition.polygon = state.kind == ShapeKind::Hull
+                             ? state.polygon
+                             : b2MakeBox(state.half_extents.x, state.half_extents.y);
+    auto body = create_box(world_, definition, state.transform.p);
+    b2Body_SetTransform(body, state.transform.p, state.transform.q);
+    return add_body(body, state.half_extents, state.colour, state.kind, {&definition.polygon, 1});
+}
+
+std::uint32_t Simulation::slot_from_user_data(void* user_data) const
+{
+    return registry_.render_slots()[registry_.index_of(registry_.handle_from_user_data(user_data))];
+}
+
+int Simulation::spawn_count(float timestep)
+{
+    if (emitter_.enabled)
+    {
+        emit_accumulator_ += emitter_.rate * timestep;
+        auto count = static_cast<int>(emit_accumulator_);
+        emit_accumulator_ -= static_cast<float>(count);
+        return std::min(count, MAX_SPAWNS_PER_STEP);
+    }
+
+    auto batch = build_batch_ > 0 && next_placement_ < placements_.size() ? build_batch_
+                                                                          : MAX_SPAWNS_PER_STEP;
+    return std::clamp(target_box_count_ - box_count_, 0, batch);
+}
+
+void Simulation::spawn_boxes(int count)
+{
+    sf::Clock clock;
+
+    std::span<const b2Polygon> polygons(&box_definition_.polygon, 1);
+    for (int i = 0; i < count; i++)
+    {
+        // Emitted boxes are sprayed out of the emitter. Otherwise they go where the scene placed
+        // them, then at random once the placements run out.
+        b2Vec2 position;
+        b2Vec2 velocity = {0, 0};
+        if (emitter_.enabled)
+        {
+            position = b2Add(emitter_.position, create_random_b2vec(rng_, -1, 1, -1, 1));
+            velocity = create_random_b2vec(rng_, -20, 20, -5, 20);
+        }
+        else if (next_placement_ < placements_.size())
+        {
+            position = placements_[next_placement_++];
+        }
+        else
+        {
+            position = create_random_b2vec(rng_);
+        }
+        auto colour = random_colour(rng_);
+
+        auto body = create_box(world_, box_definition_, position, velocity);
+        spawn_order_.push_back(add_body(body, {DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE}, colour,
+                                        ShapeKind::Box, polygons));
+        box_count_++;
+    }
+
+    // The placements are only needed while the scene is built
+    if (next_placement_ == placements_.size() && !placements_.empty())
+    {
+        placements_ = {};
+        next_placement_ = 0;
+    }
+
+    spawning_.spawned += count;
+    spawning_.spawn_time += to_milliseconds(clock.getElapsedTime());
+}
+
+void Simulation::retire_bodies()
+{
+    sf::Clock clock;
+    auto body_count = registry_.size();
+
+    for (auto handle : out_of_bounds_)
+    {
+        destroy_body(handle);
+    }
+    out_of_bounds_.clear();
+
+    while (box_count_ > target_box_count_ && !spawn_order_.empty())
+    {
+        destroy_body(spawn_order_.front());
+        spawn_order_.pop_front();
+    }
+
+    // Drop the stale handles left by bodies that left the bounds before they became the oldest
+    if (spawn_order_.size() > 2 * static_cast<std::size_t>(box_count_) + 1024)
+    {
+        std::erase_if(spawn_order_,
+                      [&](BodyHandle handle) { return !registry_.contains(handle); });
+    }
+
+    spawning_.destroyed = static_cast<int>(body_count - registry_.size());
+    spawning_.destroy_time = to_milliseconds(clock.getElapsedTime());
+}
+
+void Simulation::replay_entries(float& timestep, int& sub_steps)
+{
+    if (step_count_ >= replaying_->step_count())
+    {
+        replaying_ = nullptr;
+        return;
+    }
+
+    auto entries = replaying_->entries();
+    while (replay_cursor_ < entries.size() && entries[replay_cursor_].step <= step_count_)
+    {
+        auto& action = entries[replay_cursor_++].action;
+        if (auto rate = std::get_if<StepRate>(&action))
+        {
+            replay_timestep_ = rate->timestep;
+            replay_sub_steps_ = rate->sub_steps;
+        }
+        else
+        {
+            execute(std::get<Command>(action));
+        }
+    }
+
+    // The first recorded step always has a rate, but a damaged journal may not
+    if (replay_sub_steps_ > 0)
+    {
+        timestep = replay_timestep_;
+        sub_steps = replay_sub_steps_;
+    }
+}
+
+void Simulation::set_worker_count(int worker_count)
+{
+    if (worker_count == scheduler_.worker_count())
+    {
+        return;
+    }
+
+    auto old_world = world_;
+    scheduler_.set_worker_count(worker_count);
+    world_ = create_world(b2World_GetGravity(old_world), scheduler_);
+
+    for (std::size_t i = 0; i < registry_.size(); i++)
+    {
+        registry_.replace_body(i, copy_body(world_, registry_.bodies()[i]));
+    }
+
+    b2DestroyWorld(old_world);
+}
+
+namespace
+{
+    b2WorldId create_world(b2Vec2 gravity, TaskScheduler& scheduler)
+    {
+        b2WorldDef world_def = b2DefaultWorldDef();
+        world_def.gravity = gravity;
+        scheduler.configure(world_def);
+        return b2CreateWorld(&world_def);
+    }
+
+    b2BodyId copy_body(b2WorldId world, b2BodyId body)
+    {
+        b2BodyDef body_def = b2DefaultBodyDef();
+        body_def.type = b2Body_GetType(body);
+        body_def.position = b2Body_GetPosition(body);
+        body_def.rotation = b2Body_GetRotation(body);
+        body_def.linearVelocity = b2Body_GetLinearVelocity(body);
+        body_def.angularVelocity = b2Body_GetAngularVelocity(body);
+        body_def.linearDamping = b2Body_GetLinearDamping(body);
+        body_def.angularDamping = b2Body_GetAngularDamping(body);
+        body_def.isAwake = b2Body_IsAwake(body);
+        body_def.userData = b2Body_GetUserData(body);
+        auto copy = b2CreateBody(world, &body_def);
+
+        std::vector<b2ShapeId> shapes(b2Body_GetShapeCount(body));
+        b2Body_GetShapes(body, shapes.data(), static_cast<int>(shapes.size()));
+        for (auto shape : shapes)
+        {
+            if (b2Shape_GetType(shape) == b2_polygonShape)
+            {
+                b2ShapeDef shape_def = b2DefaultShapeDef();
+                shape_def.density = b2Shape_GetDensity(shape);
+                shape_def.material.friction = b2Shape_GetFriction(shape);
+                shape_def.filter = b2Shape_GetFilter(shape);
+
+                auto polygon = b2Shape_GetPolygon(shape);
+                b2CreatePolygonShape(copy, &shape_def, &polygon);
+            }
+        }
+        return copy;
+    }
+
+    std::vector<b2Polygon> get_polygons(b2BodyId body)
+    {
+        std::vector<b2ShapeId> shapes(b2Body_GetShapeCount(body));
+        b2Body_GetShapes(body, shapes.data(), static_cast<int>(shapes.size()));
+
+        std::vector<b2Polygon> polygons;
+        for (auto shape : shapes)
+        {
+            if (b2Shape_GetType(shape) == b2_polygonShape)
+            {
+                polygons.push_back(b2Shape_GetPolygon(shape));
+            }
+        }
+        return polygons;
+    }
+
+    b2Polygon get_polygon(b2BodyId body)
+    {
+        b2ShapeId shape;
+        b2Body_GetShapes(body, &shape, 1);
+        return b2Shape_GetPolygon(shape);
+    }
+
+    bool collect_slot(b2ShapeId shape, void* context)
+    {
+        auto& query = *static_cast<VisibleQuery*>(context);
+        auto user_data = b2Body_GetUserData(b2Shape_GetBody(shape));
+        auto handle = query.registry.handle_from_user_data(user_data);
+        query.slots.push_back(query.registry.render_slots()[query.registry.index_of(handle)]);
+
+        // Continue the query
+        return true;
+    }
+
+    b2AABB expand(b2AABB area, std::span<const b2Vec2> points, float margin)
+    {
+        for (auto point : points)
+        {
+            area.lowerBound = b2Min(area.lowerBound, b2Sub(point, {margin, margin}));
+            area.upperBound = b2Max(area.upperBound, b2Add(point, {margin, margin}));
+        }
+        return area;
+    }
+
+    bool contains(b2AABB area, b2Vec2 point)
+    {
+        return point.x >= area.lowerBound.x && point.y >= area.lowerBound.y &&
+               point.x <= area.upperBound.x && point.y <= area.upperBound.y;
+    }
+
+    float to_milliseconds(sf::Time time)
+    {
+        return time.asSeconds() * 1000.0f;
+    }
+
+    PhysicsObject create_random_special(b2WorldId world, Random& rng)
+    {
+        auto position = create_random_b2vec(rng);
+        auto colour = random_colour(rng);
+        return create_special(world, SPECIAL_POINTS, position, colour);
+    }
+
+    // SceneBody has no padding, so its bytes can be compared. Everything before the hull's index
+    // describes the body, and the index itself differs between files.
+    constexpr std::size_t RECORD_SIZE = offsetof(SceneBody, first_hull_vertex);
+
+    std::size_t hash_record(const SceneBody& body, std::span<const b2Vec2> hull)
+    {
+        auto record = std::as_bytes(std::span(&body, 1)).first(RECORD_SIZE);
+        return hash_bytes(std::as_bytes(hull), hash_bytes(record));
+    }
+
+    bool same_record(const SceneBody& a, std::span<const b2Vec2> a_hull, const SceneBody& b,
+                     std::span<const b2Vec2> b_hull)
+    {
+        return std::memcmp(&a, &b, RECORD_SIZE) == 0 && a_hull.size() == b_hull.size() &&
+               std::memcmp(a_hull.data(), b_hull.data(), a_hull.size_bytes()) == 0;
+    }
+
+    std::size_t hash_shape(const SceneBody& body, std::span<const b2Vec2> hull)
+    {
+        auto hash = hash_bytes(std::as_bytes(std::span(&body.kind, 1)));
+        hash = hash_bytes(std::as_bytes(std::span(&body.half_extents, 1)), hash);
+        hash = hash_bytes(std::as_bytes(std::span(body.colour)), hash);
+        return hash_bytes(std::as_bytes(hull), hash);
+    }
+
+    bool same_shape(const SceneBody& a, std::span<const b2Vec2> a_hull, const SceneBody& b,
+                    std::span<const b2Vec2> b_hull)
+    {
+        return a.kind == b.kind && a.half_extents.x == b.half_extents.x &&
+               a.half_extents.y == b.half_extents.y && a.colour == b.colour &&
+               a_hull.size() == b_hull.size() &&
+               std::memcmp(a_hull.data(), b_hull.data(), a_hull.size_bytes()) == 0;
+    }
+} // namespace
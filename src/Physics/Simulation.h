@@ -0,0 +1,370 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include <SFML/Graphics/Color.hpp>
+#include <box2d/box2d.h>
+
+#include "Bodies.h"
+#include "BodyRegistry.h"
+#include "SceneFile.h"
+#include "TaskScheduler.h"
+
+class Journal;
+
+/// The parameters of the scene the simulation builds
+struct SceneSettings
+{
+    b2Vec2 gravity = {0, -20.0f};
+    int box_count = 200;
+    int static_box_count = 5;
+
+    /// Seeds the random positions and colours, so the same seed always builds the same scene
+    std::uint32_t seed = 0;
+
+    /// When above 0, the dynamic boxes are created this many per step rather than all before the
+    /// first step, so a huge scene shows its first frames straight away
+    int build_batch = 0;
+};
+
+/// Pushes the dynamic bodies within the radius away from a point
+struct ExplodeCommand
+{
+    b2Vec2 position;
+
+    /// Bodies within the radius get the full impulse, which then falls off to nothing over the
+    /// falloff distance
+    float radius;
+    float falloff;
+
+    /// Impulse per metre of a shape's outline facing the explosion, so bigger shapes are pushed
+    /// harder
+    float impulse_per_length;
+};
+
+struct SetGravityCommand
+{
+    b2Vec2 gravity;
+};
+
+/// Changes how many threads step the world
+struct SetWorkerCountCommand
+{
+    int worker_count;
+};
+
+/// Puts the bodies back to how they were once the scene was built
+struct ResetCommand
+{
+};
+
+/// Sets how many dynamic boxes there should be. Missing boxes are spawned over the following
+/// steps, and extra boxes are destroyed oldest first.
+struct SetBoxCountCommand
+{
+    int box_count;
+};
+
+/// Continuously spawns boxes from a point. Once there are more boxes than the box count the
+/// oldest are retired, so the emitter keeps the world churning at a steady size.
+struct SetEmitterCommand
+{
+    bool enabled;
+
+    /// Boxes per second
+    float rate;
+    b2Vec2 position;
+};
+
+/// Applies the differences between the scene file the bodies were loaded from and a new version of
+/// it. Bodies whose lines did not change are left as they are, and edited bodies are moved in
+/// place where their shape and colour allow, so a large scene can be tweaked while it runs.
+struct ReloadSceneCommand
+{
+    std::shared_ptr<const SceneFile> file;
+};
+
+/// Everything that can change the world from outside the simulation. These go through a queue
+/// when the simulation runs on the physics thread.
+using Command = std::variant<ExplodeCommand, SetGravityCommand, SetWorkerCountCommand, ResetCommand,
+                             SetBoxCountCommand, SetEmitterCommand, ReloadSceneCommand>;
+
+/// What changed in the simulation over one step, including the commands executed before it.
+///
+/// Bodies are identified by slot: dynamic and static bodies are numbered separately, from 0
+/// upwards in the order they are created.
+struct StepEvents
+{
+    struct BodyCreated
+    {
+        std::uint32_t slot;
+        bool is_static;
+        std::vector<b2Polygon> polygons;
+        b2Transform transform;
+        sf::Color colour;
+
+        /// Size of 'moved' when the body was created, as the moves before it must be applied
+        /// before the body is created
+        std::size_t move_index;
+    };
+
+    struct BodyMoved
+    {
+        std::uint32_t slot;
+        b2Transform transform;
+
+        /// Moved by a command rather than the step, so should not be blended from where it was
+        bool teleported;
+    };
+
+    /// Slots are not reused until the events they were destroyed in have been taken, so these
+    /// can be applied after everything else
+    struct BodyDestroyed
+    {
+        std::uint32_t slot;
+        bool is_static;
+    };
+
+    /// The number of steps the simulation had run when these events were taken
+    std::uint64_t step = 0;
+
+    std::vector<BodyMoved> moved;
+    std::vector<BodyCreated> created;
+    std::vector<BodyDestroyed> destroyed;
+};
+
+/// The bodies the simulation spawned and destroyed itself in the latest step
+struct SpawnStatistics
+{
+    /// Times in milliseconds
+    float spawn_time = 0;
+    float destroy_time = 0;
+
+    int spawned = 0;
+    int destroyed = 0;
+};
+
+/// What the latest scene reload changed
+struct ReloadStatistics
+{
+    /// The number of reloads so far, 0 if there has not been one
+    int reloads = 0;
+
+    int unchanged = 0;
+    int moved = 0;
+    int added = 0;
+    int removed = 0;
+
+    /// In milliseconds
+    float time = 0;
+};
+
+/// Box2D's timings and counts from the latest step
+struct StepStatistics
+{
+    /// Times in milliseconds
+    b2Profile profile{};
+    b2Counters counters{};
+    int awake_body_count = 0;
+
+    SpawnStatistics spawning;
+    ReloadStatistics reload;
+};
+
+/// The state of the simulation's bodies at one step, so the world can be put back as it was.
+///
+/// The state of every body is kept in one array in the order of the registry's columns, so it is
+/// captured and restored in a single pass. Bodies destroyed since are recreated and bodies created
+/// since are destroyed. Box2D's contacts are not captured, so the steps after a restore can differ
+/// slightly from those after the capture. Settings changed by commands (gravity, box count,
+/// emitter) are left as they are.
+struct Checkpoint
+{
+    struct BodyState
+    {
+        BodyHandle handle;
+        b2Transform transform;
+        b2Vec2 linear_velocity;
+        float angular_velocity;
+        b2Vec2 half_extents;
+
+        /// The body's shape, relative to the body, as scene files can hold hulls of any shape
+        b2Polygon polygon;
+        sf::Color colour;
+        ShapeKind kind;
+        bool awake;
+    };
+
+    std::vector<BodyState> bodies;
+
+    /// Indices into bodies of the dynamic boxes, oldest first
+    std::vector<std::uint32_t> spawn_order;
+
+    Random rng;
+    float emit_accumulator = 0.0f;
+};
+
+/// Owns the Box2D world and the bodies in it, and records what changes in it so a renderer can
+/// follow along without touching the world itself.
+class Simulation
+{
+  public:
+    /// @param scheduler Runs the tasks of each step across threads, must outlive the simulation
+    /// @param file If set, the scene is loaded from it rather than generated from the settings
+    Simulation(const SceneSettings& settings, TaskScheduler& scheduler,
+               const SceneFile* file = nullptr);
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void execute(const Command& command);
+    void step(float timestep, int sub_steps);
+
+    /// Records the commands executed and the rate of each step into the journal, which must
+    /// outlive the recording. nullptr stops recording.
+    void record(Journal* journal);
+
+    /// Replays the journal from the current step, which should be the first step of a scene built
+    /// from the journal's settings. Its commands are executed at the steps they were recorded at,
+    /// and the step rates it recorded override the ones given to step, until its last step.
+    void replay(const Journal& journal);
+    bool is_replaying() const;
+
+    /// Moves out the events recorded since the last call
+    StepEvents take_events();
+
+    /// Finds the slots of the dynamic bodies that overlap the area, using the broadphase
+    void find_visible(b2AABB area, std::vector<std::uint32_t>& slots) const;
+
+    StepStatistics step_statistics() const;
+
+    /// Destroys the body and frees its slot. Does nothing if the handle is stale.
+    void destroy_body(BodyHandle handle);
+
+    Checkpoint checkpoint() const;
+
+    /// Puts the bodies back as they were in the checkpoint. Recreated bodies get new handles,
+    /// which are updated in the checkpoint so it can be restored again.
+    void restore(Checkpoint& checkpoint);
+
+    b2WorldId world() const;
+    std::uint64_t step_count() const;
+    const BodyRegistry& registry() const;
+
+  private:
+    /// Definitions reused for every body of a scene file
+    struct SceneDefinitions
+    {
+        BoxDefinition dynamic;
+        BoxDefinition fixed;
+    };
+
+    /// Creates the bodies saved in the scene file
+    void load(const SceneFile& file);
+
+    /// See ReloadSceneCommand
+    void reload(const SceneFile& file);
+
+    BodyHandle create_scene_body(const SceneBody& body, std::span<const b2Vec2> hull,
+                                 SceneDefinitions& definitions);
+
+    /// Moves the body to where it is in the scene file
+    void teleport(BodyHandle handle, const SceneBody& body);
+
+    /// Keeps a copy of the scene file's bodies to diff against when it is reloaded
+    void remember_scene(const SceneFile& file, std::span<const BodyHandle> handles);
+
+    /// Adds the body to the registry and gives it a slot
+    /// @param polygons The body's shapes if already known, otherwise they are read from the body
+    BodyHandle add_body(b2BodyId body, b2Vec2 half_extents, sf::Color colour, ShapeKind kind,
+                        std::span<const b2Polygon> polygons = {});
+
+    /// Creates a body destroyed since the checkpoint again
+    BodyHandle recreate_body(const Checkpoint::BodyState& state);
+
+    /// The slot of the body whose user data this is
+    std::uint32_t slot_from_user_data(void* user_data) const;
+
+    /// How many boxes to spawn in the next step, from the emitter or up to the box count when it
+    /// is off
+    int spawn_count(float timestep);
+
+    /// Spawns the boxes at the emitter, or at the next placements of the scene if any are left
+    void spawn_boxes(int count);
+
+    /// Destroys the bodies that left the world bounds and the oldest boxes over the box count
+    void retire_bodies();
+
+    /// Executes the replayed commands due before the next step, and switches to the replayed
+    /// step rate
+    void replay_entries(float& timestep, int& sub_steps);
+
+    /// Box2D fixes the worker count of a world when it is created, so the bodies are moved into a
+    /// new world with the new worker count
+    void set_worker_count(int worker_count);
+
+    TaskScheduler& scheduler_;
+    b2WorldId world_;
+    Random rng_;
+
+    BodyRegistry registry_;
+
+    /// Reused for every box spawned
+    BoxDefinition box_definition_;
+
+    int box_count_ = 0;
+    int target_box_count_;
+    SetEmitterCommand emitter_{};
+    float emit_accumulator_ = 0.0f;
+    SpawnStatistics spawning_;
+    ReloadStatistics reload_statistics_;
+
+    /// Where the scene's boxes go, generated up front so none overlap
+    std::vector<b2Vec2> placements_;
+    std::size_t next_placement_ = 0;
+
+    /// The most boxes created per step while building the scene, 0 for no limit
+    int build_batch_;
+
+    /// Bodies outside these are destroyed, covering the placements of the scene
+    b2AABB world_bounds_;
+
+    /// Taken once the scene is built, for the reset command
+    std::optional<Checkpoint> reset_checkpoint_;
+
+    // The bodies of the scene file the scene was loaded from, with the handle of the body made
+    // from each
+    std::vector<SceneBody> scene_bodies_;
+    std::vector<b2Vec2> scene_vertices_;
+    std::vector<BodyHandle> scene_handles_;
+
+    /// Handles of the dynamic boxes, oldest first. Boxes destroyed for leaving the world bounds
+    /// leave stale handles behind, which are skipped.
+    std::deque<BodyHandle> spawn_order_;
+
+    /// Bodies found outside the world bounds in the latest step
+    std::vector<BodyHandle> out_of_bounds_;
+
+    // Slots of destroyed dynamic bodies are reused, but only once the events they were destroyed
+    // in have been taken. Static slots are never reused, as they are the static geometry's ids.
+    std::uint32_t next_static_slot_ = 0;
+    std::uint32_t next_dynamic_slot_ = 0;
+    std::vector<std::uint32_t> free_dynamic_slots_;
+    std::vector<std::uint32_t> pending_free_slots_;
+
+    std::uint64_t step_count_ = 0;
+    StepEvents events_;
+
+    Journal* recording_ = nullptr;
+    const Journal* replaying_ = nullptr;
+    std::size_t replay_cursor_ = 0;
+    float replay_timestep_ = 0.0f;
+    int replay_sub_steps_ = 0;
+};
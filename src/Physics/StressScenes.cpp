@@ -0,0 +1,169 @@
+#include "StressScenes.h"
+
+#include <cmath>
+
+#include "Bodies.h"
+
+namespace
+{
+    /// The fraction of the sleeping field that starts awake
+    constexpr float AWAKE_FRACTION = 0.05f;
+
+    /// Creates a static ground centred on x = 0 with its top at y = 0
+    void create_ground(b2WorldId world, float half_width)
+    {
+        create_static_box(world, {half_width, 1.0f}, {0.0f, -1.0f});
+    }
+
+    int build_random_pile(b2WorldId world, int body_count, Random& rng)
+    {
+        // Spread out so that most boxes start clear of each other
+        auto half_width = std::sqrt(static_cast<float>(body_count)) * 3.0f;
+        create_ground(world, half_width);
+
+        for (int i = 0; i < body_count; i++)
+        {
+            auto position = create_random_b2vec(rng, -half_width, half_width, DYNAMIC_BOX_SIZE,
+                                                half_width * 2.0f);
+            auto colour = random_colour(rng);
+            create_box(world, position, colour);
+        }
+        return body_count;
+    }
+
+    int build_pyramid(b2WorldId world, int body_count, Random& rng)
+    {
+        // A pyramid with a base of n has n(n + 1) / 2 boxes
+        auto base = static_cast<int>(std::sqrt(2.0f * static_cast<float>(body_count)));
+        auto spacing = DYNAMIC_BOX_SIZE * 2.0f;
+        create_ground(world, static_cast<float>(base) * spacing);
+
+        for (int row = 0; row < base; row++)
+        {
+            auto y = DYNAMIC_BOX_SIZE + static_cast<float>(row) * spacing;
+            auto left = -static_cast<float>(base - row - 1) * spacing / 2.0f;
+            for (int column = 0; column < base - row; column++)
+            {
+                create_box(world, {left + static_cast<float>(column) * spacing, y},
+                           random_colour(rng));
+            }
+        }
+        return base * (base + 1) / 2;
+    }
+
+    int build_domino_row(b2WorldId world, int body_count)
+    {
+        constexpr b2Vec2 DOMINO_SIZE = {0.1f, 1.0f};
+        constexpr float SPACING = 1.0f;
+
+        auto half_width = static_cast<float>(body_count) * SPACING / 2.0f + SPACING;
+        create_ground(world, half_width);
+
+        b2ShapeDef shape = b2DefaultShapeDef();
+        shape.density = 1.0f;
+        shape.material.friction = 0.6f;
+        b2Polygon domino = b2MakeBox(DOMINO_SIZE.x, DOMINO_SIZE.y);
+
+        for (int i = 0; i < body_count; i++)
+        {
+            b2BodyDef body = b2DefaultBodyDef();
+            body.type = b2_dynamicBody;
+            body.position = {-half_width + SPACING * static_cast<float>(i + 1), DOMINO_SIZE.y};
+
+            // Tip the first one into the rest
+            if (i == 0)
+            {
+                body.angularVelocity = -2.0f;
+            }
+            b2CreatePolygonShape(b2CreateBody(world, &body), &shape, &domino);
+        }
+        return body_count;
+    }
+
+    int build_special_grid(b2WorldId world, int body_count, Random& rng)
+    {
+        // The hulls are 10 wide and 5 tall, packed with a small gap
+        constexpr b2Vec2 SPACING = {10.5f, 5.5f};
+
+        auto columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(body_count))));
+        auto half_width = static_cast<float>(columns) * SPACING.x / 2.0f;
+        create_ground(world, half_width + SPACING.x);
+
+        for (int i = 0; i < body_count; i++)
+        {
+            auto column = i % columns;
+            auto row = i / columns;
+            b2Vec2 position = {
+                -half_width + static_cast<float>(column) * SPACING.x + SPACING.x / 2.0f,
+                static_cast<float>(row) * SPACING.y + 0.5f,
+            };
+            create_special(world, SPECIAL_POINTS, position, random_colour(rng));
+        }
+        return body_count;
+    }
+
+    int build_sleeping_field(b2WorldId world, int body_count, Random& rng)
+    {
+        // Without gravity the bodies stay where they are put, and only the few awake ones move
+        b2World_SetGravity(world, {0.0f, 0.0f});
+
+        constexpr float SPACING = DYNAMIC_BOX_SIZE * 4.0f;
+        auto columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(body_count))));
+
+        for (int i = 0; i < body_count; i++)
+        {
+            b2Vec2 position = {
+                static_cast<float>(i % columns) * SPACING,
+                static_cast<float>(i / columns) * SPACING,
+            };
+            auto box = create_box(world, position, random_colour(rng));
+
+            if (rng.next_float() < AWAKE_FRACTION)
+            {
+                auto velocity = create_random_b2vec(rng, -10.0f, 10.0f, -10.0f, 10.0f);
+                b2Body_SetLinearVelocity(box.body, velocity);
+            }
+            else
+            {
+                b2Body_SetAwake(box.body, false);
+            }
+        }
+        return body_count;
+    }
+} // namespace
+
+std::string_view to_string(StressScene scene)
+{
+    switch (scene)
+    {
+        case StressScene::RandomPile:
+            return "random_pile";
+        case StressScene::Pyramid:
+            return "pyramid";
+        case StressScene::DominoRow:
+            return "domino_row";
+        case StressScene::SpecialGrid:
+            return "special_grid";
+        case StressScene::SleepingField:
+            return "sleeping_field";
+    }
+    return "unknown";
+}
+
+int build_stress_scene(StressScene scene, b2WorldId world, int body_count, Random& rng)
+{
+    switch (scene)
+    {
+        case StressScene::RandomPile:
+            return build_random_pile(world, body_count, rng);
+        case StressScene::Pyramid:
+            return build_pyramid(world, body_count, rng);
+        case StressScene::DominoRow:
+            return build_domino_row(world, body_count);
+        case StressScene::SpecialGrid:
+            return build_special_grid(world, body_count, rng);
+        case StressScene::SleepingField:
+            return build_sleeping_field(world, body_count, rng);
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+#include <box2d/box2d.h>
+
+#include "../Util/Random.h"
+
+/// Reproducible scenes for benchmarking the physics, each stressing a different part of the solver
+enum class StressScene
+{
+    /// Boxes dropped at random onto the ground, lots of contacts forming and resolving
+    RandomPile,
+
+    /// Stacked boxes that must stay still, the solver's stacking stability
+    Pyramid,
+
+    /// A row of dominoes knocked over from one end, a wave of contacts across the world
+    DominoRow,
+
+    /// Tightly packed special hulls, many large overlapping AABBs in the broadphase
+    SpecialGrid,
+
+    /// Bodies mostly asleep with a few moving between them, the cost of bodies that do nothing
+    SleepingField,
+};
+
+constexpr std::array<StressScene, 5> STRESS_SCENES = {
+    StressScene::RandomPile,  StressScene::Pyramid,       StressScene::DominoRow,
+    StressScene::SpecialGrid, StressScene::SleepingField,
+};
+
+std::string_view to_string(StressScene scene);
+
+/// Adds a scene of roughly body_count dynamic bodies to the world, along with any ground it needs
+/// @return The number of dynamic bodies created
+int build_stress_scene(StressScene scene, b2WorldId world, int body_count, Random& rng);
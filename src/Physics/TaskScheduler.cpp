@@ -0,0 +1,196 @@
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <format>
+#include <optional>
+
+#include "../Util/Trace.h"
+
+TaskScheduler::TaskScheduler(int worker_count)
+    : worker_count_(std::clamp(worker_count, 1, max_worker_count()))
+{
+    start_workers();
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    stop_workers();
+}
+
+void TaskScheduler::set_worker_count(int worker_count)
+{
+    worker_count = std::clamp(worker_count, 1, max_worker_count());
+    if (worker_count != worker_count_)
+    {
+        stop_workers();
+        worker_count_ = worker_count;
+        start_workers();
+    }
+}
+
+int TaskScheduler::worker_count() const
+{
+    return worker_count_;
+}
+
+int TaskScheduler::max_worker_count()
+{
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void TaskScheduler::configure(b2WorldDef& world_def)
+{
+    world_def.workerCount = worker_count_;
+    world_def.enqueueTask = &TaskScheduler::enqueue_task;
+    world_def.finishTask = &TaskScheduler::finish_task;
+    world_def.userTaskContext = this;
+}
+
+void* TaskScheduler::enqueue_task(b2TaskCallback* callback, int item_count, int min_range,
+                                  void* task_context, void* user_context)
+{
+    auto& self = *static_cast<TaskScheduler*>(user_context);
+
+    // Returning null tells Box2D the task has already been run
+    if (self.worker_count_ == 1 || self.task_count_ == MAX_TASKS)
+    {
+        callback(0, item_count, 0, task_context);
+        return nullptr;
+    }
+
+    // Split the items evenly between the workers, but no finer than Box2D asks for
+    auto worker_count = static_cast<int>(self.queues_.size());
+    auto range_size = std::max(min_range, (item_count + worker_count - 1) / worker_count);
+    auto range_count = (item_count + range_size - 1) / range_size;
+
+    auto& task = self.tasks_[self.task_count_++];
+    task.callback = callback;
+    task.context = task_context;
+    task.remaining_ranges.store(range_count, std::memory_order_relaxed);
+    self.open_tasks_++;
+
+    for (int i = 0; i < range_count; i++)
+    {
+        auto& queue = *self.queues_[self.next_queue_++ % self.queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        queue.ranges.push_back({
+            .task = &task,
+            .start = i * range_size,
+            .end = std::min(item_count, (i + 1) * range_size),
+        });
+    }
+
+    self.queued_ranges_.fetch_add(range_count, std::memory_order_release);
+    {
+        // Taking the lock means a worker cannot miss the wake up between checking for ranges and
+        // going to sleep
+        std::lock_guard lock(self.wake_mutex_);
+    }
+    self.wake_.notify_all();
+
+    return &task;
+}
+
+void TaskScheduler::finish_task(void* user_task, void* user_context)
+{
+    auto& self = *static_cast<TaskScheduler*>(user_context);
+    auto& task = *static_cast<Task*>(user_task);
+
+    // Help out rather than wait idle
+    while (task.remaining_ranges.load(std::memory_order_acquire) > 0)
+    {
+        if (!self.run_range(0))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    if (--self.open_tasks_ == 0)
+    {
+        self.task_count_ = 0;
+    }
+}
+
+void TaskScheduler::start_workers()
+{
+    for (int i = 0; i < worker_count_; i++)
+    {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    // Worker 0 is the thread stepping the world
+    for (int i = 1; i < worker_count_; i++)
+    {
+        threads_.emplace_back([this, i](std::stop_token stop_token)
+                              { worker_loop(stop_token, static_cast<std::uint32_t>(i)); });
+    }
+}
+
+void TaskScheduler::stop_workers()
+{
+    for (auto& thread : threads_)
+    {
+        thread.request_stop();
+    }
+    wake_.notify_all();
+    threads_.clear();
+    queues_.clear();
+}
+
+bool TaskScheduler::run_range(std::uint32_t worker_index)
+{
+    if (queued_ranges_.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    std::optional<Range> range;
+    for (std::size_t i = 0; i < queues_.size() && !range; i++)
+    {
+        auto& queue = *queues_[(worker_index + i) % queues_.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.ranges.empty())
+        {
+            continue;
+        }
+
+        // Take the oldest range of our own queue and steal the newest from others, so owners and
+        // thieves work from opposite ends
+        if (i == 0)
+        {
+            range = queue.ranges.front();
+            queue.ranges.pop_front();
+        }
+        else
+        {
+            range = queue.ranges.back();
+            queue.ranges.pop_back();
+        }
+    }
+    if (!range)
+    {
+        return false;
+    }
+
+    queued_ranges_.fetch_sub(1, std::memory_order_relaxed);
+
+    TraceZone zone("Box2D Task");
+    range->task->callback(range->start, range->end, worker_index, range->task->context);
+    range->task->remaining_ranges.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void TaskScheduler::worker_loop(std::stop_token stop_token, std::uint32_t worker_index)
+{
+    Trace::set_thread_name(std::format("Worker {}", worker_index));
+
+    while (!stop_token.stop_requested())
+    {
+        if (!run_range(worker_index))
+        {
+            std::unique_lock lock(wake_mutex_);
+            wake_.wait(lock, stop_token,
+                       [&] { return queued_ranges_.load(std::memory_order_acquire) > 0; });
+        }
+    }
+}
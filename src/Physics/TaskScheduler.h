@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <box2d/box2d.h>
+
+/// A work-stealing thread pool that runs the tasks Box2D splits each step into.
+///
+/// Each worker has its own queue of ranges. Workers take from the front of their own queue and,
+/// when it is empty, steal from the back of the others. The thread that steps the world is worker
+/// 0 and helps run ranges while it waits for a task to finish.
+class TaskScheduler
+{
+  public:
+    /// @param worker_count The number of threads that run tasks, including the stepping thread
+    explicit TaskScheduler(int worker_count);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /// Restarts the pool with a different number of workers. Must not be called while a world
+    /// using the scheduler is stepping, and worlds must be recreated as Box2D fixes the worker
+    /// count when a world is created.
+    void set_worker_count(int worker_count);
+    int worker_count() const;
+
+    /// The number of hardware threads, which is the most workers that are useful
+    static int max_worker_count();
+
+    /// Sets the task callbacks and worker count of the world definition to use this scheduler
+    void configure(b2WorldDef& world_def);
+
+  private:
+    /// The most tasks that can be in flight at once, Box2D only has a few per step
+    constexpr static std::size_t MAX_TASKS = 128;
+
+    struct Task
+    {
+        b2TaskCallback* callback = nullptr;
+        void* context = nullptr;
+        std::atomic<int> remaining_ranges = 0;
+    };
+
+    struct Range
+    {
+        Task* task;
+        int start;
+        int end;
+    };
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    static void* enqueue_task(b2TaskCallback* callback, int item_count, int min_range,
+                              void* task_context, void* user_context);
+    static void finish_task(void* user_task, void* user_context);
+
+    void start_workers();
+    void stop_workers();
+
+    /// Runs one range from the worker's own queue or, failing that, one stolen from another
+    /// @return false if every queue was empty
+    bool run_range(std::uint32_t worker_index);
+    void worker_loop(std::stop_token stop_token, std::uint32_t worker_index);
+
+    int worker_count_;
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::jthread> threads_;
+
+    // Sleeping workers are woken when ranges are queued
+    std::mutex wake_mutex_;
+    std::condition_variable_any wake_;
+    std::atomic<int> queued_ranges_ = 0;
+
+    // Tasks are only enqueued and finished by the stepping thread, and are reused once every task
+    // in flight has finished
+    std::array<Task, MAX_TASKS> tasks_;
+    std::size_t task_count_ = 0;
+    std::size_t open_tasks_ = 0;
+
+    /// Ranges are dealt out to the queues in turn, so single range tasks are spread out too
+    std::size_t next_queue_ = 0;
+};
@@ -0,0 +1,97 @@
+#include "ByteBuffer.h"
+
+std::uint64_t hash_bytes(std::span<const std::byte> bytes, std::uint64_t hash)
+{
+    for (auto byte : bytes)
+    {
+        hash = (hash ^ static_cast<std::uint64_t>(byte)) * 0x100000001b3;
+    }
+    return hash;
+}
+
+void ByteWriter::write(b2Vec2 value)
+{
+    write(value.x);
+    write(value.y);
+}
+
+void ByteWriter::write_varint(std::uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes_.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes_.push_back(static_cast<std::uint8_t>(value));
+}
+
+void ByteWriter::write_signed(std::int32_t value)
+{
+    auto bits = static_cast<std::uint32_t>(value);
+    write_varint((bits << 1) ^ (value < 0 ? ~0u : 0u));
+}
+
+void ByteWriter::clear()
+{
+    bytes_.clear();
+}
+
+std::size_t ByteWriter::size() const
+{
+    return bytes_.size();
+}
+
+std::span<const std::uint8_t> ByteWriter::bytes() const
+{
+    return bytes_;
+}
+
+ByteReader::ByteReader(std::span<const std::uint8_t> bytes)
+    : bytes_(bytes)
+{
+}
+
+bool ByteReader::read(b2Vec2& value)
+{
+    return read(value.x) && read(value.y);
+}
+
+bool ByteReader::read_varint(std::uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        std::uint8_t byte;
+        if (!read(byte))
+        {
+            return false;
+        }
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ByteReader::read_signed(std::int32_t& value)
+{
+    std::uint32_t bits;
+    if (!read_varint(bits))
+    {
+        return false;
+    }
+    value = static_cast<std::int32_t>((bits >> 1) ^ (~(bits & 1) + 1));
+    return true;
+}
+
+bool ByteReader::at_end() const
+{
+    return bytes_.empty();
+}
+
+std::size_t ByteReader::remaining() const
+{
+    return bytes_.size();
+}
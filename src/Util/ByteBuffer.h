@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <box2d/box2d.h>
+
+// Values are copied as they are in memory and scene files are read in place, so the binary formats
+// are little endian
+static_assert(std::endian::native == std::endian::little,
+              "The binary formats are little endian, so only run on little endian machines");
+
+/// The FNV-1a offset basis, which the hash of no bytes is
+constexpr std::uint64_t EMPTY_HASH = 0xcbf29ce484222325;
+
+/// FNV-1a, continuing from the hash of the bytes before
+std::uint64_t hash_bytes(std::span<const std::byte> bytes, std::uint64_t hash = EMPTY_HASH);
+
+/// Appends values to a growing array of bytes, for the journal and the network protocol
+class ByteWriter
+{
+  public:
+    template <typename T>
+        requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    void write(T value)
+    {
+        std::array<std::uint8_t, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), &value, sizeof(T));
+        bytes_.insert(bytes_.end(), bytes.begin(), bytes.end());
+    }
+
+    void write(b2Vec2 value);
+
+    /// 7 bits per byte, so values under 128 take one byte
+    void write_varint(std::uint32_t value);
+
+    /// Zig-zag encoded, so small negative values are small too
+    void write_signed(std::int32_t value);
+
+    /// Writes the values' bytes as they are
+    template <typename T, std::size_t N>
+        requires std::is_trivially_copyable_v<T>
+    void write_bytes(std::span<T, N> values)
+    {
+        auto bytes = reinterpret_cast<const std::uint8_t*>(values.data());
+        bytes_.insert(bytes_.end(), bytes, bytes + values.size_bytes());
+    }
+
+    /// Overwrites a value written earlier
+    template <typename T>
+        requires std::is_arithmetic_v<T>
+    void patch(std::size_t offset, T value)
+    {
+        std::memcpy(bytes_.data() + offset, &value, sizeof(T));
+    }
+
+    void clear();
+    std::size_t size() const;
+    std::span<const std::uint8_t> bytes() const;
+
+  private:
+    std::vector<std::uint8_t> bytes_;
+};
+
+/// Reads the values a ByteWriter wrote. Each read fails rather than reading past the end.
+class ByteReader
+{
+  public:
+    explicit ByteReader(std::span<const std::uint8_t> bytes);
+
+    template <typename T>
+        requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+    bool read(T& value)
+    {
+        if (bytes_.size() < sizeof(T))
+        {
+            return false;
+        }
+        std::memcpy(&value, bytes_.data(), sizeof(T));
+        bytes_ = bytes_.subspan(sizeof(T));
+        return true;
+    }
+
+    bool read(b2Vec2& value);
+    bool read_varint(std::uint32_t& value);
+    bool read_signed(std::int32_t& value);
+
+    /// Fills the values with the next bytes
+    template <typename T, std::size_t N>
+        requires std::is_trivially_copyable_v<T> && (!std::is_const_v<T>)
+    bool read_bytes(std::span<T, N> values)
+    {
+        if (bytes_.size() < values.size_bytes())
+        {
+            return false;
+        }
+        std::memcpy(values.data(), bytes_.data(), values.size_bytes());
+        bytes_ = bytes_.subspan(values.size_bytes());
+        return true;
+    }
+
+    bool at_end() const;
+    std::size_t remaining() const;
+
+  private:
+    std::span<const std::uint8_t> bytes_;
+};
@@ -0,0 +1,87 @@
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <print>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (fd_ != -1)
+    {
+        close(fd_);
+    }
+#endif
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+    path_ = std::filesystem::absolute(path);
+    std::error_code error;
+    last_write_time_ = std::filesystem::last_write_time(path_, error);
+    if (error)
+    {
+        std::println(std::cerr, "Failed to watch '{}': {}", path, error.message());
+        return false;
+    }
+
+#ifdef __linux__
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ == -1 || inotify_add_watch(fd_, path_.parent_path().c_str(),
+                                       IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+    {
+        std::println(std::cerr, "Failed to watch '{}' with inotify, polling it instead.", path);
+        if (fd_ != -1)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+#endif
+    return true;
+}
+
+bool FileWatcher::has_changed()
+{
+    if (path_.empty())
+    {
+        return false;
+    }
+
+#ifdef __linux__
+    if (fd_ != -1)
+    {
+        // Drain every queued event, as several can come from one save
+        alignas(inotify_event) char buffer[4096];
+        bool changed = false;
+        ssize_t size;
+        while ((size = read(fd_, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t offset = 0; offset < size;)
+            {
+                auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && path_.filename() == event->name)
+                {
+                    changed = true;
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+        return changed;
+    }
+#endif
+
+    std::error_code error;
+    auto write_time = std::filesystem::last_write_time(path_, error);
+    if (error || write_time == last_write_time_)
+    {
+        return false;
+    }
+    last_write_time_ = write_time;
+    return true;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+/// Notices when a file is written, so it can be loaded again while the program runs.
+///
+/// On Linux the file's directory is watched with inotify, as editors often save by writing a new
+/// file and renaming it over the old one. Elsewhere the file's modification time is polled.
+class FileWatcher
+{
+  public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /// Starts watching the file, printing the problem to std::cerr if it can not be watched
+    /// @return Whether the file is being watched
+    bool watch(const std::string& path);
+
+    /// Whether the file has been written since the last call, without blocking
+    bool has_changed();
+
+  private:
+    std::filesystem::path path_;
+    std::filesystem::file_time_type last_write_time_{};
+
+    /// The inotify instance, or -1 when the modification time is polled
+    int fd_ = -1;
+};
@@ -0,0 +1,141 @@
+#include "MappedFile.h"
+
+#include <iostream>
+#include <print>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::println(std::cerr, "Failed to open '{}'.", path);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        std::println(std::cerr, "'{}' is empty.", path);
+        CloseHandle(file);
+        return false;
+    }
+
+    // The view keeps the file mapped once the handles are closed
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (mapping)
+    {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!view)
+    {
+        std::println(std::cerr, "Failed to map '{}'.", path);
+        return false;
+    }
+
+    data_ = static_cast<const std::byte*>(view);
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+#else
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        std::println(std::cerr, "Failed to open '{}'.", path);
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) == -1 || status.st_size == 0)
+    {
+        std::println(std::cerr, "'{}' is empty.", path);
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping keeps the file open once the descriptor is closed
+    auto size = static_cast<std::size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::println(std::cerr, "Failed to map '{}'.", path);
+        return false;
+    }
+
+    // The file is read front to back once, so ask for it to be read ahead
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const std::byte*>(data);
+    size_ = size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_)
+    {
+        munmap(const_cast<std::byte*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+#endif
+
+std::span<const std::byte> MappedFile::bytes() const
+{
+    return {data_, size_};
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+/// A file mapped read-only into memory, so it can be read in place without copying it into a
+/// buffer first. Pages are only read from disk as they are touched, and stay in the OS's cache to
+/// be shared by later runs.
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Maps the whole file, printing the problem to std::cerr if it can not be mapped
+    /// @return Whether the file was mapped
+    bool open(const std::string& path);
+    void close();
+
+    /// The contents of the file, which start at the beginning of a page
+    std::span<const std::byte> bytes() const;
+
+  private:
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+};
@@ -0,0 +1,140 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+#ifdef __linux__
+namespace
+{
+    /// Opens a counter of the calling thread, on any CPU
+    int open_counter(std::uint32_t type, std::uint64_t config, int group_fd)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // The leader starts disabled so the group is enabled at once, and reads the whole group
+        if (group_fd == -1)
+        {
+            attr.disabled = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+        }
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+    }
+} // namespace
+#endif
+
+PerfSample& PerfSample::operator+=(const PerfSample& other)
+{
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    branch_misses += other.branch_misses;
+    return *this;
+}
+
+PerfSample PerfSample::operator-(const PerfSample& other) const
+{
+    return {
+        .cycles = cycles - other.cycles,
+        .instructions = instructions - other.instructions,
+        .cache_misses = cache_misses - other.cache_misses,
+        .branch_misses = branch_misses - other.branch_misses,
+    };
+}
+
+PerfSample PerfSample::operator/(std::uint64_t divisor) const
+{
+    if (divisor == 0)
+    {
+        return {};
+    }
+    return {
+        .cycles = cycles / divisor,
+        .instructions = instructions / divisor,
+        .cache_misses = cache_misses / divisor,
+        .branch_misses = branch_misses / divisor,
+    };
+}
+
+double PerfSample::ipc() const
+{
+    return cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles);
+}
+
+PerfCounters::PerfCounters()
+{
+#ifdef __linux__
+    fds_[0] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (fds_[0] == -1)
+    {
+        return;
+    }
+    fds_[1] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, fds_[0]);
+    fds_[2] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, fds_[0]);
+    fds_[3] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, fds_[0]);
+
+    // Only show the counters if every one of them can be counted
+    for (auto fd : fds_)
+    {
+        if (fd == -1)
+        {
+            return;
+        }
+    }
+
+    available_ = ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0;
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (auto fd : fds_)
+    {
+        if (fd != -1)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::is_available() const
+{
+    return available_;
+}
+
+PerfSample PerfCounters::read() const
+{
+    PerfSample sample;
+#ifdef __linux__
+    if (!available_)
+    {
+        return sample;
+    }
+
+    // PERF_FORMAT_GROUP reads the number of counters followed by each value, in the order they
+    // were opened
+    std::array<std::uint64_t, 5> values{};
+    if (::read(fds_[0], values.data(), sizeof(values)) == sizeof(values))
+    {
+        sample.cycles = values[1];
+        sample.instructions = values[2];
+        sample.cache_misses = values[3];
+        sample.branch_misses = values[4];
+    }
+#endif
+    return sample;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/// Hardware counter values, either read at a point in time or the difference between two reads
+struct PerfSample
+{
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cache_misses = 0;
+    std::uint64_t branch_misses = 0;
+
+    PerfSample& operator+=(const PerfSample& other);
+    PerfSample operator-(const PerfSample& other) const;
+    PerfSample operator/(std::uint64_t divisor) const;
+
+    /// Instructions per cycle, or 0 if no cycles were counted
+    double ipc() const;
+};
+
+/// Counts the cycles, instructions, cache misses and branch misses of the thread that creates
+/// it, using Linux's perf_event_open.
+///
+/// The counters are not available on other platforms, when perf_event_paranoid does not allow
+/// them, or on virtual machines without a PMU. Reads then return zeros, so callers only need to
+/// check is_available() to decide whether to show them.
+class PerfCounters
+{
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool is_available() const;
+
+    /// Reads every counter at once. Must be called on the thread that created the counters.
+    PerfSample read() const;
+
+  private:
+    /// The first is the group leader, which reads and enables the whole group
+    std::array<int, 4> fds_{-1, -1, -1, -1};
+    bool available_ = false;
+};
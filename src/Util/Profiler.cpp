@@ -1,65 +1,285 @@
 #include "Profiler.h"
 
+#include <algorithm>
+#include <cfloat>
+
 #include <imgui.h>
 
 namespace
 {
-    template <int S>
-    auto calculate_average(const CircularQueue<sf::Time, S>& times)
+    /// Buckets the times from 0 to max_ms, the last bucket includes anything longer
+    void fill_histogram(const CircularQueue<sf::Time, MAX_PROFILER_WINDOW>& times, float max_ms,
+                        ProfilerHistogram& histogram)
     {
-        auto sum = sf::Time::Zero;
-        for (auto time : times.data)
+        histogram.fill(0.0f);
+        if (max_ms <= 0.0f)
+        {
+            return;
+        }
+
+        auto bucket_ms = max_ms / static_cast<float>(histogram.size());
+        for (int i = 0; i < times.size(); i++)
         {
-            sum += time;
+            auto time_ms = times[i].asSeconds() * 1000.0f;
+            auto bucket = static_cast<std::size_t>(time_ms / bucket_ms);
+            histogram[std::min(bucket, histogram.size() - 1)]++;
         }
-        return sf::seconds(sum.asSeconds() / static_cast<float>(times.data.size()));
     }
 } // namespace
 
-ProfilerSection& Profiler::begin_section(const std::string& section)
+Profiler::Profiler()
+{
+    scratch_.reserve(MAX_PROFILER_WINDOW);
+    frame_times_.set_capacity(window_);
+}
+
+ProfilerId Profiler::section(std::string_view name, ProfilerId parent)
+{
+    auto itr = std::ranges::find(profiler_sections_, name, &ProfilerSection::name);
+    if (itr != profiler_sections_.end())
+    {
+        return static_cast<ProfilerId>(itr - profiler_sections_.begin());
+    }
+
+    auto id = static_cast<ProfilerId>(profiler_sections_.size());
+    auto& section = profiler_sections_.emplace_back();
+    section.name = name;
+    section.times.set_capacity(window_);
+    if (parent != NO_PROFILER_SECTION)
+    {
+        section.is_child = true;
+        profiler_sections_[parent].children.push_back(id);
+    }
+    return id;
+}
+
+ProfilerId Profiler::counter(std::string_view name)
 {
-    auto itr = profiler_sections_.find(section);
-    if (itr == profiler_sections_.end())
+    auto itr = std::ranges::find(counters_, name, &Counter::name);
+    if (itr != counters_.end())
     {
-        itr = profiler_sections_.emplace(section, ProfilerSection{}).first;
+        return static_cast<ProfilerId>(itr - counters_.begin());
     }
 
-    itr->second.clock.restart();
-    return itr->second;
+    counters_.push_back({.name = std::string{name}, .value = 0});
+    return static_cast<ProfilerId>(counters_.size() - 1);
+}
+
+ProfilerScope Profiler::scope(ProfilerId section)
+{
+    auto counters = show_counters_ && perf_counters_.is_available() ? &perf_counters_ : nullptr;
+    return ProfilerScope(profiler_sections_[section], counters);
+}
+
+void Profiler::add_section_time(ProfilerId section, sf::Time time)
+{
+    profiler_sections_[section].times.push_back(time);
+}
+
+void Profiler::add_section_counters(ProfilerId section, const PerfSample& counters)
+{
+    auto& profiler_section = profiler_sections_[section];
+    profiler_section.counters_total += counters;
+    profiler_section.counters_count++;
+}
+
+void Profiler::set_body_count(ProfilerId section, int body_count)
+{
+    profiler_sections_[section].body_count = body_count;
+}
+
+void Profiler::set_counter(ProfilerId counter, int value)
+{
+    counters_[counter].value = value;
+}
+
+ProfilerScope::ProfilerScope(ProfilerSection& section, const PerfCounters* counters)
+    : section_(section)
+    , counters_(counters)
+    , zone_(section.name.c_str())
+{
+    if (counters_)
+    {
+        start_counters_ = counters_->read();
+    }
 }
 
-void ProfilerSection::end_section()
+ProfilerScope::~ProfilerScope()
 {
-    times.push_back(clock.getElapsedTime());
+    section_.times.push_back(clock_.getElapsedTime());
+    if (counters_)
+    {
+        section_.counters_total += counters_->read() - start_counters_;
+        section_.counters_count++;
+    }
 }
 
 void Profiler::end_frame()
 {
-    frame_times_.push_back(frame_time_clock_.restart());
+    auto frame_time = frame_time_clock_.restart();
+    frame_times_.push_back(frame_time);
     frames_++;
+    Trace::end_frame();
+
+    auto frame_ms = frame_time.asSeconds() * 1000.0f;
+    if (frame_ms > budget_ms_)
+    {
+        hitches_++;
+    }
+    if (frame_ms > budget_ms_ * 2.0f)
+    {
+        severe_hitches_++;
+    }
 
     if (updater_timer_.getElapsedTime() > sf::seconds(0.25f))
     {
         updater_timer_.restart();
 
-        for (auto& [name, section] : profiler_sections_)
+        for (auto& section : profiler_sections_)
         {
-            section.average = calculate_average(section.times);
+            section.statistics = calculate_window_statistics(section.times);
+            fill_histogram(section.times, static_cast<float>(section.statistics.max),
+                           section.histogram);
+            section.counters = section.counters_total / section.counters_count;
+            section.counters_total = {};
+            section.counters_count = 0;
         }
-        average_ = calculate_average(frame_times_);
+        frame_statistics_ = calculate_window_statistics(frame_times_);
+
+        fill_histogram(frame_times_, budget_ms_ * 2.0f, frame_histogram_);
+    }
+}
+
+TimingStatistics Profiler::calculate_window_statistics(
+    const CircularQueue<sf::Time, MAX_PROFILER_WINDOW>& times)
+{
+    scratch_.clear();
+    for (int i = 0; i < times.size(); i++)
+    {
+        scratch_.push_back(times[i].asSeconds() * 1000.0);
     }
+    return calculate_statistics(scratch_);
 }
 
 void Profiler::gui()
 {
     if (ImGui::Begin("Profiler"))
     {
-        ImGui::Text("Frame: %.3fms", average_.asSeconds() * 1000.0f);
-        for (auto& [name, section] : profiler_sections_)
+        frame_time_gui();
+
+        // Writes the next frames to a file that can be opened in Perfetto
+        ImGui::BeginDisabled(Trace::is_capturing());
+        ImGui::SliderInt("Trace Frames", &trace_frames_, 1, 1000);
+        if (ImGui::Button("Capture Trace"))
+        {
+            Trace::begin_capture(trace_frames_, trace_path_);
+        }
+        ImGui::EndDisabled();
+        ImGui::Separator();
+
+        // Low IPC with many cache misses points to a section waiting on memory
+        if (perf_counters_.is_available())
+        {
+            ImGui::Checkbox("Hardware Counters", &show_counters_);
+        }
+        else
+        {
+            ImGui::TextDisabled("Hardware counters are not available");
+        }
+
+        for (auto& section : profiler_sections_)
+        {
+            if (!section.is_child)
+            {
+                section_gui(section);
+            }
+        }
+
+        if (!counters_.empty())
         {
-            ImGui::Text("%s: %.3fms", name.c_str(),
-                        section.average.asSeconds() * 1000.0f);
+            ImGui::Separator();
+            for (auto& counter : counters_)
+            {
+                ImGui::Text("%s: %d", counter.name.c_str(), counter.value);
+            }
         }
         ImGui::End();
     }
-}
\ No newline at end of file
+}
+
+void Profiler::frame_time_gui()
+{
+    auto& stats = frame_statistics_;
+    ImGui::Text("Frame: %.3fms (p50 %.3f, p90 %.3f, p99 %.3f, max %.3f)", stats.mean, stats.p50,
+                stats.p90, stats.p99, stats.max);
+
+    auto frame_time_ms = [](void* data, int index)
+    {
+        auto& times = *static_cast<CircularQueue<sf::Time, MAX_PROFILER_WINDOW>*>(data);
+        return times[index].asSeconds() * 1000.0f;
+    };
+    ImGui::PlotLines("Frame Times", frame_time_ms, &frame_times_, frame_times_.size(), 0,
+                     nullptr, 0.0f, budget_ms_ * 2.0f, {0, 80});
+    ImGui::PlotHistogram("Distribution", frame_histogram_.data(),
+                         static_cast<int>(frame_histogram_.size()), 0, "0 to 2x budget", 0.0f,
+                         FLT_MAX, {0, 80});
+
+    ImGui::Text("Hitches: %d over budget, %d over twice the budget", hitches_, severe_hitches_);
+    ImGui::SameLine();
+    if (ImGui::Button("Reset"))
+    {
+        hitches_ = 0;
+        severe_hitches_ = 0;
+    }
+    ImGui::SliderFloat("Budget (ms)", &budget_ms_, 1.0f, 100.0f);
+
+    if (ImGui::SliderInt("Window (frames)", &window_, 10, MAX_PROFILER_WINDOW))
+    {
+        frame_times_.set_capacity(window_);
+        for (auto& section : profiler_sections_)
+        {
+            section.times.set_capacity(window_);
+        }
+    }
+    ImGui::Separator();
+}
+
+void Profiler::section_gui(const ProfilerSection& section)
+{
+    auto& stats = section.statistics;
+    ImGui::Text("%s: %.3fms (p50 %.3f, p90 %.3f, p99 %.3f, max %.3f)", section.name.c_str(),
+                stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+
+    // A long tail or several peaks is hidden by the percentiles
+    ImGui::PushID(&section);
+    ImGui::PlotHistogram("##Distribution", section.histogram.data(),
+                         static_cast<int>(section.histogram.size()), 0, "0 to max", 0.0f, FLT_MAX,
+                         {0, 40});
+    ImGui::PopID();
+
+    auto& counters = section.counters;
+    if (show_counters_ && counters.cycles > 0)
+    {
+        if (section.body_count > 0)
+        {
+            auto body_count = static_cast<double>(section.body_count);
+            auto cache_misses = static_cast<double>(counters.cache_misses) / body_count;
+            auto branch_misses = static_cast<double>(counters.branch_misses) / body_count;
+            ImGui::TextDisabled("IPC %.2f, per body: %.2f cache misses, %.2f branch misses",
+                                counters.ipc(), cache_misses, branch_misses);
+        }
+        else
+        {
+            ImGui::TextDisabled("IPC %.2f, %llu cache misses, %llu branch misses", counters.ipc(),
+                                static_cast<unsigned long long>(counters.cache_misses),
+                                static_cast<unsigned long long>(counters.branch_misses));
+        }
+    }
+
+    ImGui::Indent();
+    for (auto child : section.children)
+    {
+        section_gui(profiler_sections_[child]);
+    }
+    ImGui::Unindent();
+}
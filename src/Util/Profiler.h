@@ -1,50 +1,226 @@
 #pragma once
 
-#include <deque>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <SFML/System/Clock.hpp>
 #include <SFML/System/Time.hpp>
 
+#include "PerfCounters.h"
+#include "Statistics.h"
+#include "Trace.h"
+
+/// Fixed capacity ring buffer that keeps a running sum, so the average is O(1) and pushing never
+/// allocates. Once full, each push overwrites the oldest value.
+///
+/// The capacity can be lowered at runtime from the maximum of S.
 template <typename T, int S>
-struct CircularQueue
+class CircularQueue
 {
+  public:
     void push_back(const T& new_data)
     {
-        data.push_back(new_data);
-        if (data.size() > 50)
+        if (size_ == capacity_)
+        {
+            sum_ -= data_[head_];
+        }
+        else
+        {
+            size_++;
+        }
+        data_[head_] = new_data;
+        sum_ += new_data;
+        head_ = (head_ + 1) % capacity_;
+    }
+
+    /// The oldest value is at index 0
+    const T& operator[](int index) const
+    {
+        return data_[(head_ - size_ + index + capacity_) % capacity_];
+    }
+
+    /// Keeps the newest values that fit in the new capacity
+    void set_capacity(int capacity)
+    {
+        capacity = std::clamp(capacity, 1, S);
+        auto kept = std::min(size_, capacity);
+
+        std::array<T, S> data{};
+        sum_ = T{};
+        for (int i = 0; i < kept; i++)
         {
-            data.pop_front();
+            data[i] = (*this)[size_ - kept + i];
+            sum_ += data[i];
         }
+        data_ = data;
+        capacity_ = capacity;
+        size_ = kept;
+        head_ = kept % capacity;
+    }
+
+    int size() const
+    {
+        return size_;
     }
 
-    std::deque<T> data;
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    T sum() const
+    {
+        return sum_;
+    }
+
+    T average() const
+    {
+        return size_ == 0 ? T{} : sum_ / static_cast<float>(size_);
+    }
+
+  private:
+    std::array<T, S> data_{};
+    T sum_{};
+    int capacity_ = S;
+    int head_ = 0;
+    int size_ = 0;
 };
 
+/// The most frames the statistics can be calculated over
+constexpr int MAX_PROFILER_WINDOW = 1000;
+
+/// The number of buckets the distribution of times is shown in
+constexpr int PROFILER_HISTOGRAM_BUCKETS = 40;
+using ProfilerHistogram = std::array<float, PROFILER_HISTOGRAM_BUCKETS>;
+
+/// Identifies a section or counter, registered once up front so recording is an index
+using ProfilerId = std::uint32_t;
+constexpr ProfilerId NO_PROFILER_SECTION = ~ProfilerId{0};
+
 struct ProfilerSection
 {
     std::string name;
-    sf::Clock clock;
-    CircularQueue<sf::Time, 50> times;
-    sf::Time average;
 
-    void end_section();
+    /// Sections shown nested under this one, in the order they were registered
+    std::vector<ProfilerId> children;
+    bool is_child = false;
+
+    CircularQueue<sf::Time, MAX_PROFILER_WINDOW> times;
+
+    /// In milliseconds, over the profiler's window
+    TimingStatistics statistics;
+
+    /// Times bucketed from 0 to the slowest in the window
+    ProfilerHistogram histogram{};
+
+    // Hardware counters added up since the statistics were last updated, and their average per
+    // recorded time
+    PerfSample counters_total;
+    std::uint64_t counters_count = 0;
+    PerfSample counters;
+
+    /// The number of bodies the section works on, so cache and branch misses can be shown per body
+    int body_count = 0;
+};
+
+/// Times a section until it goes out of scope, so a section can never be left open. The time is
+/// also recorded as a zone when a trace is being captured.
+class ProfilerScope
+{
+  public:
+    /// @param counters Also counts the hardware events of the section, if not null
+    ProfilerScope(ProfilerSection& section, const PerfCounters* counters);
+    ~ProfilerScope();
+
+    ProfilerScope(const ProfilerScope&) = delete;
+    ProfilerScope& operator=(const ProfilerScope&) = delete;
+
+  private:
+    ProfilerSection& section_;
+    const PerfCounters* counters_;
+    PerfSample start_counters_;
+    sf::Clock clock_;
+    TraceZone zone_;
 };
 
 class Profiler
 {
   public:
-    ProfilerSection& begin_section(const std::string& section);
+    Profiler();
+
+    /// Finds the section with the name, registering it the first time. This is the only call
+    /// that allocates, so it should be done once rather than every frame.
+    /// @param parent The section this is shown nested under when it is first registered
+    ProfilerId section(std::string_view name, ProfilerId parent = NO_PROFILER_SECTION);
+
+    /// Finds or registers a value shown alongside the timings, such as the number of bodies
+    ProfilerId counter(std::string_view name);
+
+    /// Times the section until the returned scope is destroyed. Hardware counters are only
+    /// recorded for scopes on the thread that created the profiler.
+    [[nodiscard]] ProfilerScope scope(ProfilerId section);
+
+    /// Records a time measured elsewhere, such as on another thread or by a library
+    void add_section_time(ProfilerId section, sf::Time time);
+
+    /// Records hardware counters measured elsewhere, such as with a PerfCounters on another thread
+    void add_section_counters(ProfilerId section, const PerfSample& counters);
+
+    void set_body_count(ProfilerId section, int body_count);
+
+    void set_counter(ProfilerId counter, int value);
+
     void end_frame();
 
     void gui();
 
   private:
-    std::map<std::string, ProfilerSection> profiler_sections_;
-    CircularQueue<sf::Time, 50> frame_times_;
+    struct Counter
+    {
+        std::string name;
+        int value = 0;
+    };
+
+    void section_gui(const ProfilerSection& section);
+    void frame_time_gui();
+
+    /// Calculates the statistics of the times, using the scratch buffer to sort them
+    TimingStatistics calculate_window_statistics(
+        const CircularQueue<sf::Time, MAX_PROFILER_WINDOW>& times);
+
+    std::vector<ProfilerSection> profiler_sections_;
+    std::vector<Counter> counters_;
+
+    CircularQueue<sf::Time, MAX_PROFILER_WINDOW> frame_times_;
+    TimingStatistics frame_statistics_;
     sf::Clock frame_time_clock_;
     sf::Clock updater_timer_;
     int frames_ = 0;
-    sf::Time average_;
-};
\ No newline at end of file
+
+    /// The number of frames the statistics are calculated over
+    int window_ = 300;
+
+    /// Reserved up front, so calculating percentiles does not allocate
+    std::vector<double> scratch_;
+
+    // Frames longer than the budget are counted as hitches, and those more than twice as long
+    // as severe hitches
+    float budget_ms_ = 1000.0f / 60.0f;
+    int hitches_ = 0;
+    int severe_hitches_ = 0;
+
+    /// Frame times bucketed from 0 to twice the budget, the last bucket includes anything longer
+    ProfilerHistogram frame_histogram_{};
+
+    // Cycles, instructions and misses of the scopes on the profiler's thread
+    PerfCounters perf_counters_;
+    bool show_counters_ = true;
+
+    // Trace capture settings
+    int trace_frames_ = 120;
+    std::string trace_path_ = "trace.json";
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+/// A small, fast random number generator (xoshiro128**) for spawning bodies.
+///
+/// Unlike std::mt19937 with the std distributions, whose results depend on the standard library,
+/// the same seed gives the same numbers on every compiler and platform, so seeded scenes are
+/// identical across machines. The state is 16 bytes, and each number is a few shifts and
+/// multiplies.
+class Random
+{
+  public:
+    using result_type = std::uint32_t;
+
+    explicit Random(std::uint64_t seed = 0)
+    {
+        // Spread the seed over the state with splitmix64, as xoshiro must not start all zero
+        for (int i = 0; i < 4; i += 2)
+        {
+            seed += 0x9e3779b97f4a7c15;
+            auto z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            z ^= z >> 31;
+            state_[i] = static_cast<std::uint32_t>(z);
+            state_[i + 1] = static_cast<std::uint32_t>(z >> 32);
+        }
+    }
+
+    std::uint32_t next()
+    {
+        auto result = rotate_left(state_[1] * 5, 7) * 9;
+        auto t = state_[1] << 9;
+
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotate_left(state_[3], 11);
+
+        return result;
+    }
+
+    /// In [0, 1), from the top 24 bits so every value is exactly representable
+    float next_float()
+    {
+        return static_cast<float>(next() >> 8) * 0x1.0p-24f;
+    }
+
+    /// In [min, max)
+    float range(float min, float max)
+    {
+        return min + (max - min) * next_float();
+    }
+
+    /// In [min, max]. A multiply is used rather than a modulo, which is faster and close enough to
+    /// even for ranges far smaller than 2^32.
+    int range(int min, int max)
+    {
+        auto span = static_cast<std::uint64_t>(static_cast<std::int64_t>(max) - min + 1);
+        return min + static_cast<int>((static_cast<std::uint64_t>(next()) * span) >> 32);
+    }
+
+    /// Fills the values with numbers in [min, max), for when many are needed at once
+    void fill(std::span<float> values, float min, float max)
+    {
+        for (auto& value : values)
+        {
+            value = range(min, max);
+        }
+    }
+
+    // Also usable with the std algorithms, e.g. std::shuffle
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return next();
+    }
+
+  private:
+    static std::uint32_t rotate_left(std::uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    std::array<std::uint32_t, 4> state_;
+};
@@ -0,0 +1,34 @@
+#include "Statistics.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    /// The timing at the given fraction through the sorted timings
+    double percentile(const std::vector<double>& sorted_timings, double fraction)
+    {
+        auto last = static_cast<double>(sorted_timings.size() - 1);
+        return sorted_timings[static_cast<std::size_t>(fraction * last)];
+    }
+} // namespace
+
+TimingStatistics calculate_statistics(std::vector<double>& timings)
+{
+    if (timings.empty())
+    {
+        return {};
+    }
+
+    std::ranges::sort(timings);
+    auto total = std::accumulate(timings.begin(), timings.end(), 0.0);
+    return {
+        .total = total,
+        .mean = total / static_cast<double>(timings.size()),
+        .min = timings.front(),
+        .p50 = percentile(timings, 0.50),
+        .p90 = percentile(timings, 0.90),
+        .p99 = percentile(timings, 0.99),
+        .max = timings.back(),
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+
+/// Summary of a set of timings, all in the units the timings were given in
+struct TimingStatistics
+{
+    double total = 0;
+    double mean = 0;
+    double min = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+/// Sorts the timings and summarises them
+TimingStatistics calculate_statistics(std::vector<double>& timings);
@@ -0,0 +1,58 @@
+#include "TextScanner.h"
+
+namespace
+{
+    constexpr std::string_view WHITESPACE = " \t\r";
+} // namespace
+
+TextScanner::TextScanner(std::string_view text)
+    : text_(text)
+{
+}
+
+bool TextScanner::next_line()
+{
+    while (!text_.empty())
+    {
+        auto end = text_.find('\n');
+        line_ = text_.substr(0, end);
+        text_ = end == std::string_view::npos ? std::string_view{} : text_.substr(end + 1);
+        line_number_++;
+
+        if (auto comment = line_.find('#'); comment != std::string_view::npos)
+        {
+            line_ = line_.substr(0, comment);
+        }
+        skip_whitespace();
+        if (!line_.empty())
+        {
+            return true;
+        }
+    }
+    line_ = {};
+    return false;
+}
+
+std::string_view TextScanner::next_token()
+{
+    auto token = line_.substr(0, line_.find_first_of(WHITESPACE));
+    line_.remove_prefix(token.size());
+    skip_whitespace();
+    return token;
+}
+
+bool TextScanner::at_line_end() const
+{
+    return line_.empty();
+}
+
+int TextScanner::line_number() const
+{
+    return line_number_;
+}
+
+void TextScanner::skip_whitespace()
+{
+    auto start = line_.find_first_not_of(WHITESPACE);
+    line_.remove_prefix(start == std::string_view::npos ? line_.size() : start);
+}
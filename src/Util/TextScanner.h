@@ -0,0 +1,49 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+
+/// Splits text into lines of whitespace separated tokens, for simple hand written formats.
+///
+/// Tokens are views into the text and numbers are parsed with std::from_chars, so nothing is
+/// copied or allocated however big the text is. Blank lines and comments, from '#' to the end of
+/// the line, are skipped.
+class TextScanner
+{
+  public:
+    explicit TextScanner(std::string_view text);
+
+    /// Moves to the next line with any tokens on it
+    /// @return False at the end of the text
+    bool next_line();
+
+    /// The next token on the line, or empty at the end of the line
+    std::string_view next_token();
+
+    /// Parses the next token on the line as a number
+    /// @return False if there are no tokens left or the token is not a number
+    template <typename T>
+    bool next_number(T& value)
+    {
+        auto token = next_token();
+        auto end = token.data() + token.size();
+        auto [ptr, ec] = std::from_chars(token.data(), end, value);
+        return !token.empty() && ec == std::errc{} && ptr == end;
+    }
+
+    /// Whether every token on the line has been read
+    bool at_line_end() const;
+
+    /// The line being read, from 1
+    int line_number() const;
+
+  private:
+    void skip_whitespace();
+
+    /// The text after the current line
+    std::string_view text_;
+
+    /// The rest of the current line
+    std::string_view line_;
+    int line_number_ = 0;
+};
@@ -0,0 +1,226 @@
+#include "Trace.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <print>
+#include <vector>
+
+namespace
+{
+    /// Zones past this many in one capture are dropped for that thread
+    constexpr std::size_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct TraceEvent
+    {
+        const char* name;
+        std::int64_t start;
+        std::int64_t end;
+    };
+
+    /// Written only by its thread, and read by the capturing thread once the capture ends
+    struct ThreadBuffer
+    {
+        std::uint32_t thread_id = 0;
+        std::string thread_name;
+
+        /// The capture the events are from, so stale events are cleared by the owning thread
+        std::atomic<std::uint32_t> generation = 0;
+        std::atomic<std::size_t> count = 0;
+        std::array<TraceEvent, EVENTS_PER_THREAD> events;
+
+        /// Buffers are reused by new threads once their thread exits
+        bool in_use = false;
+    };
+
+    // Buffers are only allocated the first time a thread records, and are never freed as they
+    // may be read after their thread exits
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    std::atomic<bool> capturing = false;
+    std::atomic<std::uint32_t> capture_generation = 0;
+    int frames_remaining = 0;
+    std::string capture_path;
+
+    const auto EPOCH = std::chrono::steady_clock::now();
+
+    std::int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - EPOCH)
+            .count();
+    }
+
+    ThreadBuffer* acquire_buffer(const std::string& thread_name)
+    {
+        std::lock_guard lock(buffers_mutex);
+        for (auto& buffer : buffers)
+        {
+            if (!buffer->in_use)
+            {
+                buffer->in_use = true;
+                buffer->thread_name = thread_name;
+                return buffer.get();
+            }
+        }
+
+        auto& buffer = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+        buffer->thread_id = static_cast<std::uint32_t>(buffers.size());
+        buffer->thread_name = thread_name;
+        buffer->in_use = true;
+        return buffer.get();
+    }
+
+    /// Gives each thread a buffer, returning it for reuse when the thread exits
+    struct ThreadBufferHandle
+    {
+        ~ThreadBufferHandle()
+        {
+            if (buffer)
+            {
+                std::lock_guard lock(buffers_mutex);
+                buffer->in_use = false;
+            }
+        }
+
+        ThreadBuffer& get()
+        {
+            if (!buffer)
+            {
+                buffer = acquire_buffer(thread_name);
+            }
+            return *buffer;
+        }
+
+        ThreadBuffer* buffer = nullptr;
+
+        /// Kept here until the thread first records, so naming a thread does not allocate a buffer
+        std::string thread_name;
+    };
+    thread_local ThreadBufferHandle thread_buffer;
+
+    void record(const char* name, std::int64_t start, std::int64_t end)
+    {
+        auto& buffer = thread_buffer.get();
+
+        auto generation = capture_generation.load(std::memory_order_acquire);
+        if (buffer.generation.load(std::memory_order_relaxed) != generation)
+        {
+            buffer.count.store(0, std::memory_order_relaxed);
+            buffer.generation.store(generation, std::memory_order_release);
+        }
+
+        auto count = buffer.count.load(std::memory_order_relaxed);
+        if (count < EVENTS_PER_THREAD)
+        {
+            buffer.events[count] = {.name = name, .start = start, .end = end};
+            buffer.count.store(count + 1, std::memory_order_release);
+        }
+    }
+
+    void write_trace(const std::string& path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::println(std::cerr, "Failed to open '{}' to write the trace.", path);
+            return;
+        }
+
+        auto generation = capture_generation.load(std::memory_order_relaxed);
+        auto separator = "";
+        std::size_t event_count = 0;
+
+        std::println(file, "{{\"traceEvents\": [");
+        std::lock_guard lock(buffers_mutex);
+        for (auto& buffer : buffers)
+        {
+            if (buffer->generation.load(std::memory_order_acquire) != generation)
+            {
+                continue;
+            }
+
+            if (!buffer->thread_name.empty())
+            {
+                std::println(file,
+                             "{}{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                             "\"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+                             separator, buffer->thread_id, buffer->thread_name);
+                separator = ",";
+            }
+
+            // Zones ended after the capture stopped may still be being added, but only past count
+            auto count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                auto& event = buffer->events[i];
+                std::println(file,
+                             "{}{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, "
+                             "\"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                             separator, event.name, buffer->thread_id, event.start / 1000.0,
+                             (event.end - event.start) / 1000.0);
+                separator = ",";
+            }
+            event_count += count;
+        }
+        std::println(file, "]}}");
+
+        std::println("Wrote {} trace events to '{}'.", event_count, path);
+    }
+} // namespace
+
+void Trace::begin_capture(int frames, std::string path)
+{
+    if (capturing || frames <= 0)
+    {
+        return;
+    }
+
+    frames_remaining = frames;
+    capture_path = std::move(path);
+    capture_generation.fetch_add(1, std::memory_order_release);
+    capturing = true;
+}
+
+bool Trace::is_capturing()
+{
+    return capturing.load(std::memory_order_relaxed);
+}
+
+void Trace::end_frame()
+{
+    if (capturing && --frames_remaining == 0)
+    {
+        capturing = false;
+        write_trace(capture_path);
+    }
+}
+
+void Trace::set_thread_name(std::string name)
+{
+    thread_buffer.thread_name = std::move(name);
+    if (thread_buffer.buffer)
+    {
+        std::lock_guard lock(buffers_mutex);
+        thread_buffer.buffer->thread_name = thread_buffer.thread_name;
+    }
+}
+
+TraceZone::TraceZone(const char* name)
+    : name_(name)
+    , start_(Trace::is_capturing() ? now() : -1)
+{
+}
+
+TraceZone::~TraceZone()
+{
+    if (start_ >= 0)
+    {
+        record(name_, start_, now());
+    }
+}
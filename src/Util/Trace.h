@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// Records timed zones from any thread and writes them out as a Chrome trace_event JSON file,
+/// which can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+///
+/// Each thread records into its own fixed size buffer, so recording never locks or allocates.
+/// Zones are only recorded while a capture is running.
+class Trace
+{
+  public:
+    /// Starts recording, writing the trace to the path once the number of frames have ended
+    static void begin_capture(int frames, std::string path);
+    static bool is_capturing();
+
+    /// Called once per frame by the thread that started the capture
+    static void end_frame();
+
+    /// Names the calling thread in the trace
+    static void set_thread_name(std::string name);
+};
+
+/// Records the time from construction to destruction as a zone in the trace. Zones nest by
+/// scope, so zones inside others show as their children.
+class TraceZone
+{
+  public:
+    /// @param name Must outlive the capture, e.g. a string literal
+    explicit TraceZone(const char* name);
+    ~TraceZone();
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+  private:
+    const char* name_;
+
+    /// Nanoseconds since the trace epoch, or -1 if not capturing when the zone began
+    std::int64_t start_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/// Passes the latest value from one producer thread to one consumer thread without locking.
+///
+/// The producer writes into the back buffer and publishes it, the consumer picks up the most
+/// recently published buffer. Neither ever waits for the other; values published while the
+/// consumer is busy are overwritten by newer ones.
+template <typename T>
+class TripleBuffer
+{
+  public:
+    /// Producer: The buffer to write the next value into
+    T& back()
+    {
+        return buffers_[back_];
+    }
+
+    /// Producer: Makes the back buffer the latest value, and takes a new back buffer
+    void publish()
+    {
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /// Consumer: Swaps in the latest published value to the front buffer
+    /// @return false if nothing has been published since the last call
+    bool consume()
+    {
+        if (!(middle_.load(std::memory_order_relaxed) & FRESH))
+        {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /// Consumer: The latest value taken by consume()
+    const T& front() const
+    {
+        return buffers_[front_];
+    }
+
+  private:
+    constexpr static std::uint8_t INDEX = 0x3;
+    constexpr static std::uint8_t FRESH = 0x4;
+
+    std::array<T, 3> buffers_;
+    std::uint8_t back_ = 0;
+    std::atomic<std::uint8_t> middle_ = 1;
+    std::uint8_t front_ = 2;
+};
@@ -2,8 +2,6 @@
 
 #include <filesystem>
 #include <ostream>
-#include <string_view>
-#include <vector>
 
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Vector2.hpp>
@@ -15,7 +13,4 @@ std::ostream& operator<<(std::ostream& stream, const sf::Vector2<T>& vector)
     return stream;
 }
 
-void load_texture(sf::Texture& texture, const std::filesystem::path& file_path);
-
-[[nodiscard]] std::string read_file_to_string(const std::filesystem::path& file_path);
-[[nodiscard]] std::vector<std::string> split_string(const std::string& string, char delim = ' ');
\ No newline at end of file
+void load_texture(sf::Texture& texture, const std::filesystem::path& file_path);
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "Viewer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <print>
+#include <vector>
+
+#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Window/Event.hpp>
+#include <imgui.h>
+#include <imgui_sfml/imgui-SFML.h>
+
+#include "CommandLine.h"
+#include "Graphics/BodyRenderer.h"
+#include "Graphics/Camera.h"
+#include "Network/SnapshotClient.h"
+#include "Util/Profiler.h"
+#include "Util/Trace.h"
+
+namespace
+{
+    /// Gives each body of the snapshots a slot in the renderer, which is its own for as long as it
+    /// stays in the snapshots.
+    ///
+    /// Static bodies are drawn as dynamic bodies that never move, as they come and go with the
+    /// camera and the static geometry is rebuilt whenever a body is added or removed.
+    class ViewerBodies
+    {
+      public:
+        /// Adds, moves and removes the bodies that differ from the previous snapshot
+        void apply(const NetworkSnapshot& snapshot, const SnapshotClient& client,
+                   BodyRenderer& renderer);
+
+        std::size_t size() const;
+
+      private:
+        /// @return Whether the body's shape has arrived, so it could be added
+        bool add(const NetworkBody& body, std::uint32_t slot, const SnapshotClient& client,
+                 BodyRenderer& renderer);
+
+        // The bodies of the previous snapshot and their slots
+        std::vector<NetworkBody> bodies_;
+        std::vector<std::uint32_t> slots_;
+        std::vector<NetworkBody> next_bodies_;
+        std::vector<std::uint32_t> next_slots_;
+
+        /// Slots are only reused by a later snapshot, so none is removed and added in one step
+        std::vector<std::uint32_t> free_slots_;
+        std::vector<std::uint32_t> freed_slots_;
+        std::uint32_t slot_count_ = 0;
+    };
+
+    /// Profiler handles for what the viewer receives
+    struct ClientProfilerIds
+    {
+        ProfilerId receive;
+        ProfilerId deserialize;
+        ProfilerId apply;
+        ProfilerId received_bytes;
+        ProfilerId snapshots;
+        ProfilerId lost_snapshots;
+        ProfilerId bodies;
+    };
+
+    ClientProfilerIds register_client_statistics(Profiler& profiler);
+
+    /// Window event handling
+    void handle_event(const sf::Event& event, bool& show_debug_info, bool& close_requested);
+} // namespace
+
+int run_viewer(const CommandLineOptions& options)
+{
+    SnapshotClient client;
+    if (!client.connect(options.connect_address))
+    {
+        return EXIT_FAILURE;
+    }
+
+    sf::RenderWindow window(sf::VideoMode({1600, 900}), "Box2D 3 + SFML 3 Viewer",
+                            sf::State::Windowed, {.antiAliasingLevel = 4});
+    window.setVerticalSyncEnabled(true);
+    if (!ImGui::SFML::Init(window))
+    {
+        std::println(std::cerr, "Failed to init ImGUI::SFML.");
+        return EXIT_FAILURE;
+    }
+
+    Profiler profiler;
+    Trace::set_thread_name("Main");
+    if (options.trace_frames > 0)
+    {
+        Trace::begin_capture(options.trace_frames, options.trace_path);
+    }
+    auto ids = register_client_statistics(profiler);
+    auto render_section = profiler.section("Render");
+    Camera camera;
+    camera.view.setCenter(sf::Vector2f{window.getSize()} / 2.0f);
+
+    BodyRenderer body_renderer(1.0f / SCALE);
+    ViewerBodies bodies;
+
+    // Snapshots arrive less often than frames, so the bodies are drawn blended between the last
+    // two by how far it is through the time between snapshots
+    sf::Clock snapshot_clock;
+    float snapshot_interval = 1.0f / 30.0f;
+    bool interpolate = true;
+
+    sf::Clock clock;
+    bool show_debug_info = false;
+    while (window.isOpen())
+    {
+        bool close_requested = false;
+        while (auto event = window.pollEvent())
+        {
+            ImGui::SFML::ProcessEvent(window, *event);
+            handle_event(*event, show_debug_info, close_requested);
+        }
+        auto dt = clock.restart();
+        camera.update(dt);
+
+        ImGui::SFML::Update(window, dt);
+        window.clear(sf::Color::Black);
+
+        camera.view.setSize(sf::Vector2f{window.getSize()});
+        client.set_view_area(to_box2d_aabb(camera.view, window.getSize().y));
+        const NetworkSnapshot* snapshot = nullptr;
+        {
+            auto scope = profiler.scope(ids.receive);
+            snapshot = client.receive();
+        }
+        if (snapshot)
+        {
+            profiler.add_section_time(ids.deserialize, client.statistics().deserialize_time);
+
+            auto scope = profiler.scope(ids.apply);
+            bodies.apply(*snapshot, client, body_renderer);
+            snapshot_interval =
+                std::lerp(snapshot_interval, snapshot_clock.restart().asSeconds(), 0.1f);
+        }
+        auto alpha = snapshot_clock.getElapsedTime().asSeconds() / snapshot_interval;
+        body_renderer.interpolate(interpolate ? std::min(alpha, 1.0f) : 1.0f);
+
+        {
+            auto scope = profiler.scope(render_section);
+            window.setView(camera.view);
+
+            // The server only sends the bodies around the view, so there is nothing to cull
+            TraceZone zone("Bodies");
+            body_renderer.draw(window, to_sfml_render_states(window.getSize().y), false);
+        }
+
+        auto& statistics = client.statistics();
+        profiler.set_counter(ids.received_bytes, statistics.bytes_per_second);
+        profiler.set_counter(ids.snapshots, statistics.snapshots_per_second);
+        profiler.set_counter(ids.lost_snapshots, statistics.lost_snapshots);
+        profiler.set_counter(ids.bodies, static_cast<int>(bodies.size()));
+        profiler.set_body_count(render_section, static_cast<int>(bodies.size()));
+        profiler.end_frame();
+        if (show_debug_info)
+        {
+            profiler.gui();
+        }
+
+        if (ImGui::Begin("Viewer"))
+        {
+            ImGui::Text("Use WASD to move the camera around.");
+            if (client.is_connected())
+            {
+                ImGui::Text("Viewing %s", options.connect_address.c_str());
+            }
+            else
+            {
+                ImGui::Text("Connecting to %s...", options.connect_address.c_str());
+            }
+            ImGui::Text("Bodies: %zu", bodies.size());
+            ImGui::Text("Received: %.1f KB/s, %d snapshots/s",
+                        statistics.bytes_per_second / 1024.0f, statistics.snapshots_per_second);
+            ImGui::Text("Lost Snapshots: %d", statistics.lost_snapshots);
+            ImGui::Checkbox("Interpolate", &interpolate);
+            ImGui::Checkbox("Draw Outlines", &body_renderer.draw_outlines);
+        }
+        ImGui::End();
+
+        {
+            TraceZone zone("ImGui");
+            ImGui::SFML::Render(window);
+        }
+        {
+            TraceZone zone("Display");
+            window.display();
+        }
+        if (close_requested)
+        {
+            window.close();
+        }
+    }
+
+    ImGui::SFML::Shutdown(window);
+    return EXIT_SUCCESS;
+}
+
+namespace
+{
+    void ViewerBodies::apply(const NetworkSnapshot& snapshot, const SnapshotClient& client,
+                             BodyRenderer& renderer)
+    {
+        free_slots_.insert(free_slots_.end(), freed_slots_.begin(), freed_slots_.end());
+        freed_slots_.clear();
+        next_bodies_.clear();
+        next_slots_.clear();
+        renderer.begin_step();
+
+        // Both are in order of id, so are merged to find what was added, removed and moved
+        auto& latest = snapshot.bodies;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < latest.size() || j < bodies_.size())
+        {
+            if (j == bodies_.size() || (i < latest.size() && latest[i].id < bodies_[j].id))
+            {
+                std::uint32_t slot;
+                if (free_slots_.empty())
+                {
+                    slot = slot_count_++;
+                }
+                else
+                {
+                    slot = free_slots_.back();
+                    free_slots_.pop_back();
+                }
+
+                if (add(latest[i], slot, client, renderer))
+                {
+                    next_bodies_.push_back(latest[i]);
+                    next_slots_.push_back(slot);
+                }
+                else
+                {
+                    freed_slots_.push_back(slot);
+                }
+                i++;
+            }
+            else if (i == latest.size() || bodies_[j].id < latest[i].id)
+            {
+                renderer.remove_body(slots_[j]);
+                freed_slots_.push_back(slots_[j]);
+                j++;
+            }
+            else
+            {
+                auto& body = latest[i];
+                auto slot = slots_[j];
+                bool kept = true;
+                if (body.generation != bodies_[j].generation)
+                {
+                    // The server reused the slot for another body
+                    renderer.remove_body(slot);
+                    kept = add(body, slot, client, renderer);
+                }
+                else if (body.x != bodies_[j].x || body.y != bodies_[j].y ||
+                         body.angle != bodies_[j].angle)
+                {
+                    renderer.set_transform(slot, dequantize(body));
+                }
+
+                if (kept)
+                {
+                    next_bodies_.push_back(body);
+                    next_slots_.push_back(slot);
+                }
+                else
+                {
+                    freed_slots_.push_back(slot);
+                }
+                i++;
+                j++;
+            }
+        }
+        std::swap(bodies_, next_bodies_);
+        std::swap(slots_, next_slots_);
+    }
+
+    std::size_t ViewerBodies::size() const
+    {
+        return bodies_.size();
+    }
+
+    bool ViewerBodies::add(const NetworkBody& body, std::uint32_t slot,
+                           const SnapshotClient& client, BodyRenderer& renderer)
+    {
+        auto shape = client.shape(body.id);
+        if (!shape || shape->generation != body.generation)
+        {
+            return false;
+        }
+        renderer.add_body(slot, shape->polygons, dequantize(body), shape->colour);
+        return true;
+    }
+
+    ClientProfilerIds register_client_statistics(Profiler& profiler)
+    {
+        ClientProfilerIds ids{};
+        ids.receive = profiler.section("Receive Snapshots");
+        ids.deserialize = profiler.section("Deserialize Snapshots", ids.receive);
+        ids.apply = profiler.section("Apply Snapshot");
+        ids.received_bytes = profiler.counter("Received Bytes/s");
+        ids.snapshots = profiler.counter("Snapshots/s");
+        ids.lost_snapshots = profiler.counter("Lost Snapshots");
+        ids.bodies = profiler.counter("Bodies");
+        return ids;
+    }
+
+    void handle_event(const sf::Event& event, bool& show_debug_info, bool& close_requested)
+    {
+        if (event.is<sf::Event::Closed>())
+        {
+            close_requested = true;
+        }
+        else if (auto* key = event.getIf<sf::Event::KeyPressed>())
+        {
+            switch (key->code)
+            {
+                case sf::Keyboard::Key::Escape:
+                    close_requested = true;
+                    break;
+
+                case sf::Keyboard::Key::F1:
+                    show_debug_info = !show_debug_info;
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+} // namespace
@@ -0,0 +1,7 @@
+#pragma once
+
+struct CommandLineOptions;
+
+/// Draws the bodies streamed by a server started with --serve, rather than simulating them
+/// @return The exit code
+int run_viewer(const CommandLineOptions& options);
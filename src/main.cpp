@@ -1,6 +1,9 @@
+#include <array>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <print>
-#include <random>
 
 #include <SFML/Graphics/ConvexShape.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
@@ -10,25 +13,28 @@
 #include <imgui.h>
 #include <imgui_sfml/imgui-SFML.h>
 
+#include "CommandLine.h"
+#include "Graphics/BodyRenderer.h"
+#include "Graphics/Camera.h"
+#include "Graphics/StaticGeometry.h"
+#include "Headless.h"
+#include "Network/SnapshotServer.h"
+#include "Physics/Journal.h"
+#include "Physics/PhysicsThread.h"
+#include "Physics/SceneFile.h"
+#include "Physics/Simulation.h"
+#include "Physics/TaskScheduler.h"
+#include "Util/FileWatcher.h"
 #include "Util/Keyboard.h"
 #include "Util/Profiler.h"
+#include "Util/Trace.h"
+#include "Viewer.h"
 
 namespace
 {
-    /// Convert between Box2D and SFML sizes, so 1 meter = 'SCALE' pixels
-    constexpr float SCALE = 8.f;
-
-    /// Size of the dynamic_boxes
-    constexpr float DYNAMIC_BOX_SIZE = 1.0f;
-
-    /// The number of dynamic boxes to spawn at the start
-    constexpr int BOX_COUNT = 200;
-
-    /// The number of static to spawn at the start
-    constexpr float STATIC_BOX_COUNT = 5;
-
-    /// Camera movement speed
-    constexpr float CAMERA_SPEED = 10.0f;
+    /// The most physics steps that can run in one frame. When the simulation cannot keep up, time
+    /// is dropped rather than running ever more steps per frame and falling further behind
+    constexpr int MAX_STEPS_PER_FRAME = 8;
 
     /// Converts a Box2D vector to a SFML vector scaled from meters to pixels
     sf::Vector2f to_sfml_position(b2Vec2 box2d_position, int window_height);
@@ -36,49 +42,134 @@ namespace
     /// Converts a Box2D size to SFML size for rendering
     sf::Vector2f to_sfml_size(b2Vec2 box2d_size);
 
-    /// Creates a random vec2
-    b2Vec2 create_random_b2vec(float x_min = 10.0f, float x_max = 50.0f, float y_min = 10.0f,
-                               float y_max = 50.0f);
-
-    /// Generate a random colour
-    sf::Color random_colour();
-
-    struct Box
+    /// Applies the events of a simulation step to the renderers, in the order they happened, and
+    /// to the server's copy of the bodies if serving
+    void apply_events(const StepEvents& events, BodyRenderer& body_renderer,
+                      StaticGeometry& static_geometry, SnapshotServer* server);
+
+    /// Applies the steps of a snapshot that have not been applied yet
+    /// @return The latest step that has been applied
+    std::uint64_t apply_snapshot(const PhysicsSnapshot& snapshot, std::uint64_t applied_step,
+                                 BodyRenderer& body_renderer, StaticGeometry& static_geometry,
+                                 SnapshotServer* server);
+
+    /// The phases of a Box2D step shown in the profiler, times are in milliseconds
+    constexpr std::array<std::pair<const char*, float b2Profile::*>, 8> STEP_PHASES = {{
+        {"Box2D Step", &b2Profile::step},
+        {"Box2D Pairs", &b2Profile::pairs},
+        {"Box2D Collide", &b2Profile::collide},
+        {"Box2D Solve", &b2Profile::solve},
+        {"Box2D Split Islands", &b2Profile::splitIslands},
+        {"Box2D Transforms", &b2Profile::transforms},
+        {"Box2D Refit", &b2Profile::refit},
+        {"Box2D Sleep Islands", &b2Profile::sleepIslands},
+    }};
+
+    /// Profiler handles for Box2D's breakdown of a step
+    struct StepProfilerIds
     {
-        b2Vec2 size;
-        b2BodyId body;
-        sf::Color colour;
+        std::array<ProfilerId, STEP_PHASES.size()> phases;
+        ProfilerId spawn;
+        ProfilerId destroy;
+        ProfilerId spawned;
+        ProfilerId destroyed;
+        ProfilerId bodies;
+        ProfilerId awake_bodies;
+        ProfilerId contacts;
+        ProfilerId islands;
     };
 
-    struct PhysicsObject
-    {
-        b2BodyId body;
-        sf::ConvexShape shape;
-    };
+    /// Registers the step breakdown with the profiler, nested under the parent section
+    StepProfilerIds register_step_statistics(Profiler& profiler, ProfilerId parent);
 
-    /// Creates a box that has physics applied to it at a random position
-    Box create_box(b2WorldId world);
+    /// Adds Box2D's breakdown of the latest step to the profiler
+    void record_step_statistics(Profiler& profiler, const StepProfilerIds& ids,
+                                const StepStatistics& statistics);
 
-    /// Create a box that does not move
-    Box create_static_box(b2WorldId world, b2Vec2 size, b2Vec2 position);
+    /// Profiler handles for the snapshot server
+    struct ServerProfilerIds
+    {
+        ProfilerId network;
+        ProfilerId serialize;
+        ProfilerId viewers;
+        ProfilerId sent_bytes;
+        ProfilerId snapshot_bodies;
+        ProfilerId sent_bodies;
+    };
 
-    PhysicsObject create_special(b2WorldId world, const std::vector<b2Vec2>& points);
+    ServerProfilerIds register_server_statistics(Profiler& profiler);
 
-    void apply_explosion(b2BodyId body, float explode_strength, sf::Vector2f explosion_position);
+    /// Adds what the server sent to the profiler
+    /// @param sent Whether snapshots were sent this frame, so took time to serialize
+    void record_server_statistics(Profiler& profiler, const ServerProfilerIds& ids,
+                                  const ServerStatistics& statistics, bool sent);
 
     /// Window event handing
     void handle_event(const sf::Event& event, sf::Window& window, bool& show_debug_info,
                       bool& close_requested);
-
-    struct Camera
-    {
-        sf::View view;
-        sf::Vector2f speed;
-    };
 } // namespace
 
-int main()
+int main(int argc, char** argv)
 {
+    sf::Clock startup_clock;
+    auto options = parse_command_line(argc, argv);
+    if (!options)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+    if (options->show_help)
+    {
+        print_usage();
+        return EXIT_SUCCESS;
+    }
+
+    // Viewers only draw what the server sends, so build no scene of their own
+    if (!options->connect_address.empty())
+    {
+        return run_viewer(*options);
+    }
+
+    // A journal is replayed in the scene it was recorded in, for the repeatable performance tests
+    std::optional<Journal> replay;
+    if (!options->replay_path.empty())
+    {
+        replay = Journal::load(options->replay_path);
+        if (!replay)
+        {
+            return EXIT_FAILURE;
+        }
+        options->scene = replay->scene();
+        options->worker_count = replay->worker_count();
+        if (options->load_scene_path.empty())
+        {
+            options->load_scene_path = replay->scene_file_path();
+        }
+    }
+
+    // The scene is built straight from the mapped file
+    SceneFile scene_file;
+    bool load_scene = !options->load_scene_path.empty();
+    if (load_scene)
+    {
+        if (!scene_file.open(options->load_scene_path))
+        {
+            return EXIT_FAILURE;
+        }
+        options->scene.box_count = scene_file.box_count();
+        options->scene.gravity = scene_file.gravity();
+    }
+    if (replay && !replay->check_scene_file(load_scene ? &scene_file : nullptr))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (options->headless)
+    {
+        return run_headless(*options, replay ? &*replay : nullptr,
+                            load_scene ? &scene_file : nullptr);
+    }
+
     sf::RenderWindow window(sf::VideoMode({1600, 900}), "Box2D 3 + SFML 3", sf::State::Windowed,
                             {.antiAliasingLevel = 4});
     window.setVerticalSyncEnabled(true);
@@ -89,49 +180,137 @@ int main()
     }
 
     Profiler profiler;
+    Trace::set_thread_name("Main");
+    if (options->trace_frames > 0)
+    {
+        Trace::begin_capture(options->trace_frames, options->trace_path);
+    }
+    auto update_section = profiler.section("Update");
+    auto physics_thread_section = profiler.section("Physics Thread Step", update_section);
+    auto step_profiler_ids = register_step_statistics(profiler, update_section);
+    auto render_section = profiler.section("Render");
     Keyboard keyboard;
     Camera camera;
     camera.view.setCenter(sf::Vector2f{window.getSize()} / 2.0f);
 
-    b2Vec2 gravity = {0, -20.0f};
+    b2Vec2 gravity = options->scene.gravity;
 
-    /// Define the world
-    b2WorldDef world_def = b2DefaultWorldDef();
-    world_def.gravity = gravity;
-    b2WorldId world = b2CreateWorld(&world_def);
+    // Box2D splits each step into tasks that run across all the cores
+    TaskScheduler task_scheduler(options->worker_count);
+    auto worker_count = task_scheduler.worker_count();
 
-    // Create static boxes
-    std::vector<Box> static_boxes = {
-        create_static_box(world, {60, 1}, {61, 2}),
-        create_static_box(world, {1, 40}, {2, 43}),
-        create_static_box(world, {60, 1}, {61, 90}),
-    };
+    sf::Clock build_clock;
+    Simulation simulation(options->scene, task_scheduler, load_scene ? &scene_file : nullptr);
+    auto build_time = build_clock.getElapsedTime();
+    sf::Time time_to_first_frame;
 
-    for (int i = 0; i < STATIC_BOX_COUNT; i++)
+    std::optional<Journal> recording;
+    if (!options->record_path.empty())
     {
-        static_boxes.push_back(
-            create_static_box(world, {2, 2}, create_random_b2vec(20, 70, 20, 50)));
+        recording.emplace(options->scene, worker_count);
+        if (load_scene)
+        {
+            recording->set_scene_file(options->load_scene_path, scene_file);
+        }
+        simulation.record(&*recording);
+    }
+    if (replay)
+    {
+        simulation.replay(*replay);
     }
 
-    // Create dynamic boxes
-    std::vector<Box> dynamic_boxes;
-    for (int i = 0; i < BOX_COUNT; i++)
+    // Everything has been copied out of the file, so it is unmapped before it is watched. An
+    // editor that truncates it while saving would otherwise leave the mapping past its end.
+    scene_file = SceneFile{};
+
+    // Outlines are 1 pixel thick to match the box_rectangle
+    BodyRenderer body_renderer(1.0f / SCALE);
+    StaticGeometry static_geometry(1.0f / SCALE);
+    bool batch_rendering = true;
+
+    // When culling, only the shapes that overlap the camera are rendered, found using the Box2D
+    // broadphase
+    std::vector<std::uint32_t> visible_slots;
+    bool camera_culling = true;
+
+    // Viewers started with --connect are streamed the bodies, from the same events the renderers
+    // are given
+    std::optional<SnapshotServer> server;
+    ServerProfilerIds server_profiler_ids{};
+    if (options->serve_port != 0)
     {
-        dynamic_boxes.push_back(create_box(world));
+        server.emplace();
+        if (!server->listen(options->serve_port))
+        {
+            return EXIT_FAILURE;
+        }
+        server_profiler_ids = register_server_statistics(profiler);
     }
+    auto* streaming = server ? &*server : nullptr;
+
+    apply_events(simulation.take_events(), body_renderer, static_geometry, streaming);
+    std::uint64_t applied_step = 0;
+
+    // When the physics thread is running it owns the simulation, so commands are queued for it
+    // and the renderers are updated from the snapshots it publishes
+    PhysicsThread physics_thread(simulation);
+    bool use_physics_thread = false;
+    auto execute = [&](Command command)
+    {
+        // The replay is only repeatable if nothing else changes the world while it runs
+        if (replay && applied_step < replay->step_count())
+        {
+            return;
+        }
 
-    auto special = create_special(world, {{-5.0f, 0.0f}, {5.0f, 0.0f}, {0.0f, 5.0f}});
+        if (physics_thread.is_running())
+        {
+            physics_thread.push_command(std::move(command));
+        }
+        else
+        {
+            simulation.execute(command);
+        }
+    };
 
     sf::RectangleShape box_rectangle;
     box_rectangle.setOutlineColor(sf::Color::White);
     box_rectangle.setOutlineThickness(1.0f);
 
+    sf::ConvexShape special_shape;
+    special_shape.setOutlineColor(sf::Color::White);
+    special_shape.setOutlineThickness(1.0f);
+
     sf::Clock clock;
 
     // Parameters used for the box2d simulations
-    auto timestep = 1.f / 60.f;
-    auto sub_steps = 4;
-    auto explode_strength = 50.0f;
+    auto physics_rate = static_cast<int>(std::round(1.0f / options->timestep));
+    auto sub_steps = options->sub_steps;
+    auto explode_radius = 10.0f;
+    auto explode_falloff = 20.0f;
+    auto explode_strength = 20.0f;
+    auto box_count = options->scene.box_count;
+    auto save_scene_path =
+        options->save_scene_path.empty() ? std::string("scene.b2scene") : options->save_scene_path;
+    SetEmitterCommand emitter{.enabled = false, .rate = 1000.0f, .position = {60, 70}};
+
+    // A loaded scene is reloaded whenever it is saved, so it can be edited while it runs
+    FileWatcher scene_watcher;
+    if (load_scene)
+    {
+        scene_watcher.watch(options->load_scene_path);
+    }
+
+    // The physics runs at a fixed rate independent of the frame rate, so the real frame time is
+    // accumulated and consumed in fixed steps
+    auto accumulator = 0.0f;
+    auto steps_last_frame = 0;
+    auto dropped_time = 0.0f;
+    bool interpolate = true;
+
+    // Shown in the Config window, as the reloads run on the physics thread when it is enabled
+    ReloadStatistics last_reload;
+    bool vsync = true;
 
     // Start the sim
     bool show_debug_info = false;
@@ -156,108 +335,196 @@ int main()
                         (window.getSize().y - pixel.y) / SCALE,
                     };
 
-                    // Move all the dynamic_boxes away from the mouse point by applying a linear
-                    // impulse
-                    for (auto& box : dynamic_boxes)
-                    {
-
-                        apply_explosion(box.body, explode_strength, world_position);
-
-                    }
-
-                    // apply_explosion(special.body, explode_strength, mouse_position);
+                    execute(ExplodeCommand{
+                        .position = {world_position.x, world_position.y},
+                        .radius = explode_radius,
+                        .falloff = explode_falloff,
+                        .impulse_per_length = explode_strength,
+                    });
                 }
             }
         }
         auto dt = clock.restart();
 
-        sf::Vector2f change{};
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::A))
-        {
-            change.x += -CAMERA_SPEED;
-        }
-        else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::D))
-        {
-            change.x += CAMERA_SPEED;
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W))
-        {
-            change.y += -CAMERA_SPEED;
-        }
-        else if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S))
+        if (scene_watcher.has_changed())
         {
-            change.y += CAMERA_SPEED;
+            // A file that fails to open, such as one saved half way through an edit, is left
+            // until it is saved again
+            auto file = std::make_shared<SceneFile>();
+            if (file->open(options->load_scene_path))
+            {
+                gravity = file->gravity();
+                box_count = file->box_count();
+                execute(ReloadSceneCommand{std::move(file)});
+            }
         }
 
-        camera.speed += change * dt.asSeconds();
-        camera.view.move(camera.speed);
-        camera.speed *= 0.95f;
+        camera.update(dt);
 
         ImGui::SFML::Update(window, dt);
         window.clear(sf::Color::Black);
 
         // Update the world and do the physics simulation
         {
-            auto& section = profiler.begin_section("Update");
-            b2World_Step(world, timestep, sub_steps);
-            section.end_section();
+            auto scope = profiler.scope(update_section);
+            if (physics_thread.is_running())
+            {
+                physics_thread.set_rate(physics_rate, sub_steps);
+                physics_thread.set_view_area(to_box2d_aabb(camera.view, window.getSize().y));
+
+                // Snapshots only arrive when the physics thread has stepped, so the bodies are
+                // drawn at their latest transforms rather than interpolated
+                steps_last_frame = 0;
+                if (auto snapshot = physics_thread.consume())
+                {
+                    applied_step = apply_snapshot(*snapshot, applied_step, body_renderer,
+                                                  static_geometry, streaming);
+                    physics_thread.acknowledge(applied_step);
+                    body_renderer.set_visible(snapshot->visible);
+
+                    steps_last_frame = snapshot->steps;
+                    // The steps run on the physics thread, but are shown under Update where
+                    // they would be when not threaded
+                    profiler.add_section_time(physics_thread_section, snapshot->step_time);
+                    profiler.add_section_counters(physics_thread_section,
+                                                  snapshot->step_counters);
+                    record_step_statistics(profiler, step_profiler_ids, snapshot->statistics);
+                    last_reload = snapshot->statistics.reload;
+                }
+                body_renderer.interpolate(1.0f);
+            }
+            else
+            {
+                auto timestep = 1.0f / static_cast<float>(physics_rate);
+                accumulator += dt.asSeconds();
+
+                steps_last_frame = 0;
+                while (accumulator >= timestep && steps_last_frame < MAX_STEPS_PER_FRAME)
+                {
+                    body_renderer.begin_step();
+                    simulation.step(timestep, sub_steps);
+
+                    auto events = simulation.take_events();
+                    apply_events(events, body_renderer, static_geometry, streaming);
+                    applied_step = events.step;
+
+                    accumulator -= timestep;
+                    steps_last_frame++;
+                }
+                if (accumulator >= timestep)
+                {
+                    dropped_time += accumulator - std::fmod(accumulator, timestep);
+                    accumulator = std::fmod(accumulator, timestep);
+                }
+
+                if (steps_last_frame > 0)
+                {
+                    auto statistics = simulation.step_statistics();
+                    record_step_statistics(profiler, step_profiler_ids, statistics);
+                    last_reload = statistics.reload;
+                }
+
+                // Commands executed since the last step, e.g. when no step ran this frame
+                apply_events(simulation.take_events(), body_renderer, static_geometry,
+                             streaming);
+
+                // Bodies are drawn between their last two steps, by how far the accumulator is
+                // through the next step
+                body_renderer.interpolate(interpolate ? accumulator / timestep : 1.0f);
+            }
+        }
+
+        if (server)
+        {
+            bool sent = false;
+            {
+                auto scope = profiler.scope(server_profiler_ids.network);
+                sent = server->update();
+            }
+            record_server_statistics(profiler, server_profiler_ids, server->statistics(), sent);
         }
 
         {
-            auto& section = profiler.begin_section("Render");
+            auto scope = profiler.scope(render_section);
 
             camera.view.setSize(sf::Vector2f{window.getSize()});
             window.setView(camera.view);
 
-            // Render the static geometry
-            for (auto& box : static_boxes)
+            // The unbatched path reads the world directly, so is not available while the physics
+            // thread owns it
+            if (batch_rendering || physics_thread.is_running())
             {
-                auto position = b2Body_GetPosition(box.body);
-
-                box_rectangle.setRotation(sf::Angle::Zero);
-                box_rectangle.setPosition(to_sfml_position(position, window.getSize().y));
-                box_rectangle.setSize(to_sfml_size(box.size));
-                box_rectangle.setOrigin(box_rectangle.getSize() / 2.f);
-                box_rectangle.setFillColor(box.colour);
-                window.draw(box_rectangle);
-            }
+                auto states = to_sfml_render_states(window.getSize().y);
+                {
+                    TraceZone zone("Static Geometry");
+                    static_geometry.draw(window, states);
+                }
 
-            // Draw all the dynamic_boxes
-            for (auto& box : dynamic_boxes)
-            {
-                // Get the position and rotation from box2d
-                auto radians = b2Rot_GetAngle(b2Body_GetRotation(box.body));
-                auto position = b2Body_GetPosition(box.body);
-
-                box_rectangle.setRotation(sf::radians(radians));
-                box_rectangle.setPosition(to_sfml_position(position, window.getSize().y));
-                box_rectangle.setSize(to_sfml_size(box.size));
-                box_rectangle.setOrigin(box_rectangle.getSize() / 2.f);
-                box_rectangle.setFillColor(box.colour);
-                window.draw(box_rectangle);
-            }
+                // The physics thread finds the visible bodies itself after each step
+                if (camera_culling && !physics_thread.is_running())
+                {
+                    TraceZone zone("Culling");
+                    simulation.find_visible(to_box2d_aabb(camera.view, window.getSize().y),
+                                            visible_slots);
+                    body_renderer.set_visible(visible_slots);
+                }
 
-            // Draw special shapes
-            {
-                auto radians = b2Rot_GetAngle(b2Body_GetRotation(special.body));
-                auto position = b2Body_GetPosition(special.body);
-
-                special.shape.setRotation(sf::radians(-radians));
-                special.shape.setPosition(to_sfml_position(position, window.getSize().y));
-                window.draw(special.shape);
-
-                box_rectangle.setRotation(sf::Angle::Zero);
-                box_rectangle.setPosition(special.shape.getPosition());
-                box_rectangle.setSize({2, 2});
-                // box_rectangle.setOrigin({0,0});
-                box_rectangle.setFillColor(sf::Color::Red);
-                window.draw(box_rectangle);
+                TraceZone zone("Bodies");
+                body_renderer.draw(window, states, camera_culling);
             }
+            else
+            {
+                auto& registry = simulation.registry();
+                auto bodies = registry.bodies();
+                auto kinds = registry.kinds();
+                for (std::size_t i = 0; i < registry.size(); i++)
+                {
+                    // Get the position and rotation from box2d
+                    auto radians = b2Rot_GetAngle(b2Body_GetRotation(bodies[i]));
+                    auto position = b2Body_GetPosition(bodies[i]);
 
-            section.end_section();
+                    if (kinds[i] != ShapeKind::Hull)
+                    {
+                        box_rectangle.setRotation(sf::radians(radians));
+                        box_rectangle.setPosition(to_sfml_position(position, window.getSize().y));
+                        box_rectangle.setSize(to_sfml_size(registry.half_extents()[i]));
+                        box_rectangle.setOrigin(box_rectangle.getSize() / 2.f);
+                        box_rectangle.setFillColor(registry.colours()[i]);
+                        window.draw(box_rectangle);
+                        continue;
+                    }
+
+                    // Hulls have a single polygon shape
+                    b2ShapeId shape;
+                    b2Body_GetShapes(bodies[i], &shape, 1);
+                    auto polygon = b2Shape_GetPolygon(shape);
+                    special_shape.setPointCount(polygon.count);
+                    for (int j = 0; j < polygon.count; j++)
+                    {
+                        auto point = polygon.vertices[j];
+                        special_shape.setPoint(j, {point.x * SCALE, -point.y * SCALE});
+                    }
+                    special_shape.setFillColor(registry.colours()[i]);
+                    special_shape.setRotation(sf::radians(-radians));
+                    special_shape.setPosition(to_sfml_position(position, window.getSize().y));
+                    window.draw(special_shape);
+
+                    box_rectangle.setRotation(sf::Angle::Zero);
+                    box_rectangle.setPosition(special_shape.getPosition());
+                    box_rectangle.setSize({2, 2});
+                    box_rectangle.setFillColor(sf::Color::Red);
+                    window.draw(box_rectangle);
+                }
+            }
         }
 
-        // Show profiler
+        // Show profiler, with cache and branch misses given per body drawn or simulated
+        auto body_count = static_cast<int>(body_renderer.body_count());
+        auto drawn_count = camera_culling ? static_cast<int>(body_renderer.visible_count())
+                                          : body_count;
+        profiler.set_body_count(update_section, body_count);
+        profiler.set_body_count(physics_thread_section, body_count);
+        profiler.set_body_count(render_section, drawn_count);
         profiler.end_frame();
         if (show_debug_info)
         {
@@ -269,34 +536,154 @@ int main()
         {
             ImGui::Text("Use WASD to move the camera around.");
 
-            ImGui::SliderFloat("Explode Strength", &explode_strength, 1.0f, 10000.0f);
+            ImGui::Checkbox("Batch Rendering", &batch_rendering);
+            if (batch_rendering)
+            {
+                if (ImGui::Checkbox("Draw Outlines", &body_renderer.draw_outlines))
+                {
+                    static_geometry.draw_outlines = body_renderer.draw_outlines;
+                }
+                ImGui::Checkbox("Camera Culling", &camera_culling);
+                if (camera_culling)
+                {
+                    ImGui::Text("Visible Bodies: %zu / %zu", body_renderer.visible_count(),
+                                body_renderer.body_count());
+                }
+            }
+
+            if (ImGui::Checkbox("Physics Thread", &use_physics_thread))
+            {
+                if (use_physics_thread)
+                {
+                    physics_thread.set_rate(physics_rate, sub_steps);
+                    physics_thread.start();
+                }
+                else
+                {
+                    // Catch up with anything published since the last frame before taking the
+                    // simulation back
+                    physics_thread.stop();
+                    if (auto snapshot = physics_thread.consume())
+                    {
+                        applied_step = apply_snapshot(*snapshot, applied_step, body_renderer,
+                                                      static_geometry, streaming);
+                    }
+                    accumulator = 0.0f;
+                }
+            }
+            ImGui::SliderInt("Physics Rate (Hz)", &physics_rate, 30, 240);
+            // Changing the worker count rebuilds the world, so wait until the slider is let go
+            ImGui::SliderInt("Workers", &worker_count, 1, TaskScheduler::max_worker_count());
+            if (ImGui::IsItemDeactivatedAfterEdit())
+            {
+                execute(SetWorkerCountCommand{worker_count});
+            }
+            ImGui::Checkbox("Interpolate", &interpolate);
+            if (ImGui::Checkbox("VSync", &vsync))
+            {
+                window.setVerticalSyncEnabled(vsync);
+            }
+            // Passing the seed with --seed builds the same scene again
+            ImGui::Text("Seed: %u", options->scene.seed);
+            if (replay && applied_step < replay->step_count())
+            {
+                ImGui::Text("Replaying: Step %llu / %llu",
+                            static_cast<unsigned long long>(applied_step),
+                            static_cast<unsigned long long>(replay->step_count()));
+            }
+            if (recording)
+            {
+                ImGui::Text("Recording to %s", options->record_path.c_str());
+            }
+            ImGui::Text("Scene Build: %.1fms, First Frame: %.1fms",
+                        build_time.asSeconds() * 1000.0f,
+                        time_to_first_frame.asSeconds() * 1000.0f);
+            if (last_reload.reloads > 0)
+            {
+                ImGui::Text("Reload %d: %d unchanged, %d moved, %d added, %d removed in %.1fms",
+                            last_reload.reloads, last_reload.unchanged, last_reload.moved,
+                            last_reload.added, last_reload.removed, last_reload.time);
+            }
+            ImGui::Text("Steps Last Frame: %d", steps_last_frame);
+            ImGui::Text("Time Dropped: %.3fs", dropped_time);
+
+            ImGui::SliderFloat("Explode Radius", &explode_radius, 0.0f, 100.0f);
+            ImGui::SliderFloat("Explode Falloff", &explode_falloff, 0.0f, 100.0f);
+            ImGui::SliderFloat("Explode Strength", &explode_strength, 1.0f, 1000.0f);
             if (ImGui::SliderFloat2("Gravity", &gravity.x, -100.0f, 100.0f))
             {
-                b2World_SetGravity(world, gravity);
+                execute(SetGravityCommand{gravity});
             }
             if (ImGui::Button("Set No Gravity"))
             {
                 gravity = {0, 0};
-                b2World_SetGravity(world, gravity);
+                execute(SetGravityCommand{gravity});
+            }
+
+            // Spawning or destroying thousands of boxes at once takes a while, so wait until the
+            // slider is let go
+            ImGui::SliderInt("Box Count", &box_count, 0, 200000, "%d",
+                             ImGuiSliderFlags_Logarithmic);
+            if (ImGui::IsItemDeactivatedAfterEdit())
+            {
+                execute(SetBoxCountCommand{box_count});
+            }
+            bool emitter_changed = ImGui::Checkbox("Emitter", &emitter.enabled);
+            if (emitter.enabled)
+            {
+                emitter_changed |= ImGui::SliderFloat("Emit Rate (boxes/s)", &emitter.rate, 10.0f,
+                                                      20000.0f, "%.0f",
+                                                      ImGuiSliderFlags_Logarithmic);
+                emitter_changed |=
+                    ImGui::SliderFloat2("Emitter Position", &emitter.position.x, 0.0f, 120.0f);
+            }
+            if (emitter_changed)
+            {
+                execute(emitter);
+            }
+
+            // The physics thread owns the simulation while it runs
+            ImGui::BeginDisabled(physics_thread.is_running());
+            if (ImGui::Button("Save Scene"))
+            {
+                SceneFile::save(simulation, save_scene_path);
+            }
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::Text("to %s", save_scene_path.c_str());
+
+            if (server)
+            {
+                auto& statistics = server->statistics();
+                ImGui::Text("Serving on port %u: %d viewers, %.1f KB/s", options->serve_port,
+                            statistics.viewers, statistics.bytes_per_second / 1024.0f);
+                ImGui::SliderInt("Snapshot Rate (Hz)", &server->snapshot_rate, 1, 60);
             }
 
             if (ImGui::Button("Reset Boxes and View"))
             {
                 camera.view.setCenter(sf::Vector2f{window.getSize()} / 2.0f);
-                for (auto& box : dynamic_boxes)
-                {
-                    b2Body_SetLinearVelocity(box.body, {0, 0});
-                    b2Body_SetAngularVelocity(box.body, 0);
-                    b2Body_SetTransform(box.body, create_random_b2vec(), b2Rot_identity);
-                }
-                special = create_special(world, {{-5.0f, 0.0f}, {5.0f, 0.0f}, {0.0f, 5.0f}});
+                execute(ResetCommand{});
             }
         }
         ImGui::End();
 
         // End frame
-        ImGui::SFML::Render(window);
-        window.display();
+        {
+            TraceZone zone("ImGui");
+            ImGui::SFML::Render(window);
+        }
+        {
+            TraceZone zone("Display");
+            window.display();
+        }
+        if (time_to_first_frame == sf::Time::Zero)
+        {
+            time_to_first_frame = startup_clock.getElapsedTime();
+            std::println("Scene built in {:.3f}ms, first frame shown after {:.3f}ms",
+                         build_time.asMicroseconds() / 1000.0,
+                         time_to_first_frame.asMicroseconds() / 1000.0);
+        }
         if (close_requested)
         {
             window.close();
@@ -304,16 +691,12 @@ int main()
     }
 
     // Cleanup
-    ImGui::SFML::Shutdown(window);
-    for (auto& box : dynamic_boxes)
+    physics_thread.stop();
+    if (recording)
     {
-        b2DestroyBody(box.body);
+        recording->save(options->record_path);
     }
-    for (auto& box : static_boxes)
-    {
-        b2DestroyBody(box.body);
-    }
-    b2DestroyWorld(world);
+    ImGui::SFML::Shutdown(window);
 }
 
 namespace
@@ -334,123 +717,139 @@ namespace
         return {box_size.x * SCALE * 2, box_size.y * SCALE * 2};
     }
 
-    b2Vec2 create_random_b2vec(float x_min, float x_max, float y_min, float y_max)
+    void apply_events(const StepEvents& events, BodyRenderer& body_renderer,
+                      StaticGeometry& static_geometry, SnapshotServer* server)
     {
-        static std::random_device rd;
-        static std::mt19937 rng(rd());
-        return {
-            std::uniform_real_distribution(x_min, x_max)(rng),
-            std::uniform_real_distribution(y_min, y_max)(rng),
-        };
-    }
+        if (server)
+        {
+            server->apply_events(events);
+        }
 
-    sf::Color random_colour()
-    {
-        // constexpr static std::array<sf::Color, 7> COLOURS{
-        //     sf::Color::White,  sf::Color::Red,     sf::Color::Green, sf::Color::Blue,
-        //     sf::Color::Yellow, sf::Color::Magenta, sf::Color::Cyan,
-        // };
-        static std::random_device rd;
-        static std::mt19937 rng(rd());
-        return {
-            static_cast<uint8_t>(std::uniform_int_distribution<int>(0, 255)(rng)),
-            static_cast<uint8_t>(std::uniform_int_distribution<int>(0, 255)(rng)),
-            static_cast<uint8_t>(std::uniform_int_distribution<int>(0, 255)(rng)),
+        auto apply_moves = [&](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; i++)
+            {
+                auto& moved = events.moved[i];
+                if (moved.teleported)
+                {
+                    body_renderer.teleport(moved.slot, moved.transform);
+                }
+                else
+                {
+                    body_renderer.set_transform(moved.slot, moved.transform);
+                }
+            }
         };
-    }
-
-    Box create_box(b2WorldId world)
-    {
-        b2BodyDef body = b2DefaultBodyDef();
-        body.type = b2_dynamicBody;
-        body.position = create_random_b2vec();
 
-        // As this example has no gravity, damping needs to be applied or objects will float and
-        // spin forever
-        body.linearDamping = 1.0f;
-        body.angularDamping = 1.0f;
-
-        b2ShapeDef shape = b2DefaultShapeDef();
-        shape.density = 1.0f;
-        shape.material.friction = 0.3f;
+        std::size_t move_index = 0;
+        for (auto& created : events.created)
+        {
+            apply_moves(move_index, created.move_index);
+            move_index = created.move_index;
 
-        b2BodyId body_id = b2CreateBody(world, &body);
-        b2Polygon box = b2MakeBox(DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE);
-        b2CreatePolygonShape(body_id, &shape, &box);
+            if (created.is_static)
+            {
+                static_geometry.add_body(created.polygons, created.transform, created.colour);
+            }
+            else
+            {
+                body_renderer.add_body(created.slot, created.polygons, created.transform,
+                                       created.colour);
+            }
+        }
+        apply_moves(move_index, events.moved.size());
 
-        return {
-            .size = {DYNAMIC_BOX_SIZE, DYNAMIC_BOX_SIZE},
-            .body = body_id,
-            .colour = random_colour(),
-        };
+        for (auto& destroyed : events.destroyed)
+        {
+            if (destroyed.is_static)
+            {
+                static_geometry.remove_body(destroyed.slot);
+            }
+            else
+            {
+                body_renderer.remove_body(destroyed.slot);
+            }
+        }
     }
 
-    Box create_static_box(b2WorldId world, b2Vec2 size, b2Vec2 position)
+    std::uint64_t apply_snapshot(const PhysicsSnapshot& snapshot, std::uint64_t applied_step,
+                                 BodyRenderer& body_renderer, StaticGeometry& static_geometry,
+                                 SnapshotServer* server)
     {
-        b2BodyDef body = b2DefaultBodyDef();
-        body.type = b2_staticBody;
-        body.position = {position.x, position.y};
-
-        b2Polygon box = b2MakeBox(size.x, size.y);
-        b2ShapeDef shape = b2DefaultShapeDef();
-        b2BodyId body_id = b2CreateBody(world, &body);
-
-        b2CreatePolygonShape(body_id, &shape, &box);
+        for (auto& events : snapshot.events)
+        {
+            if (events.step > applied_step)
+            {
+                body_renderer.begin_step();
+                apply_events(events, body_renderer, static_geometry, server);
+                applied_step = events.step;
+            }
+        }
+        return applied_step;
+    }
 
-        return {
-            .size = size,
-            .body = body_id,
-            .colour = sf::Color::Green,
-        };
+    StepProfilerIds register_step_statistics(Profiler& profiler, ProfilerId parent)
+    {
+        StepProfilerIds ids{};
+        for (std::size_t i = 0; i < STEP_PHASES.size(); i++)
+        {
+            ids.phases[i] = profiler.section(STEP_PHASES[i].first, parent);
+        }
+        ids.spawn = profiler.section("Spawn Bodies", parent);
+        ids.destroy = profiler.section("Destroy Bodies", parent);
+        ids.spawned = profiler.counter("Spawned");
+        ids.destroyed = profiler.counter("Destroyed");
+        ids.bodies = profiler.counter("Bodies");
+        ids.awake_bodies = profiler.counter("Awake Bodies");
+        ids.contacts = profiler.counter("Contacts");
+        ids.islands = profiler.counter("Islands");
+        return ids;
     }
 
-    PhysicsObject create_special(b2WorldId world, const std::vector<b2Vec2>& points)
+    void record_step_statistics(Profiler& profiler, const StepProfilerIds& ids,
+                                const StepStatistics& statistics)
     {
-        b2BodyDef body = b2DefaultBodyDef();
-        body.type = b2_dynamicBody;
-        body.position = create_random_b2vec();
-        body.linearDamping = 1.0f;
-        body.angularDamping = 1.0f;
-
-        b2ShapeDef shape = b2DefaultShapeDef();
-        shape.density = 1.0f;
-        shape.material.friction = 0.3f;
-
-        b2BodyId body_id = b2CreateBody(world, &body);
-        b2Hull hull = b2ComputeHull(points.data(), points.size());
-        b2Polygon polygon = b2MakePolygon(&hull, 0);
-        b2CreatePolygonShape(body_id, &shape, &polygon);
-
-        PhysicsObject object;
-        object.shape.setPointCount(points.size());
-        for (std::size_t i = 0; i < points.size(); i++)
+        for (std::size_t i = 0; i < STEP_PHASES.size(); i++)
         {
-            object.shape.setPoint(i, {points[i].x * SCALE, -points[i].y * SCALE});
+            auto milliseconds = statistics.profile.*STEP_PHASES[i].second;
+            profiler.add_section_time(ids.phases[i], sf::seconds(milliseconds / 1000.0f));
         }
-        object.shape.setFillColor(random_colour());
-        object.shape.setOutlineColor(sf::Color::White);
-        object.shape.setOutlineThickness(1.0f);
-        object.body = body_id;
 
-        // b2Vec2 com = b2Body_GetLocalCenterOfMass(body_id);
-        //  object.shape.setOrigin({com.x * SCALE, com.y * SCALE});
+        auto& spawning = statistics.spawning;
+        profiler.add_section_time(ids.spawn, sf::seconds(spawning.spawn_time / 1000.0f));
+        profiler.add_section_time(ids.destroy, sf::seconds(spawning.destroy_time / 1000.0f));
+        profiler.set_counter(ids.spawned, spawning.spawned);
+        profiler.set_counter(ids.destroyed, spawning.destroyed);
 
-        return object;
+        profiler.set_counter(ids.bodies, statistics.counters.bodyCount);
+        profiler.set_counter(ids.awake_bodies, statistics.awake_body_count);
+        profiler.set_counter(ids.contacts, statistics.counters.contactCount);
+        profiler.set_counter(ids.islands, statistics.counters.islandCount);
     }
 
-    void apply_explosion(b2BodyId body, float explode_strength, sf::Vector2f explosion_position)
+    ServerProfilerIds register_server_statistics(Profiler& profiler)
     {
-        auto body_pos = b2Body_GetPosition(body);
-        auto body_position = sf::Vector2f{body_pos.x, body_pos.y};
+        ServerProfilerIds ids{};
+        ids.network = profiler.section("Network");
+        ids.serialize = profiler.section("Serialize Snapshots", ids.network);
+        ids.viewers = profiler.counter("Viewers");
+        ids.sent_bytes = profiler.counter("Sent Bytes/s");
+        ids.snapshot_bodies = profiler.counter("Snapshot Bodies");
+        ids.sent_bodies = profiler.counter("Sent Bodies");
+        return ids;
+    }
 
-        auto diff = body_position - explosion_position;
-        auto distance = diff.lengthSquared() / 2.0f;
-        if (distance > 0.001f)
+    void record_server_statistics(Profiler& profiler, const ServerProfilerIds& ids,
+                                  const ServerStatistics& statistics, bool sent)
+    {
+        if (sent)
         {
-            // The strength depends with distance
-            diff *= explode_strength / distance;
-            b2Body_ApplyLinearImpulse(body, {diff.x, diff.y}, body_pos, true);
+            profiler.add_section_time(ids.serialize, statistics.serialize_time);
         }
+        profiler.set_counter(ids.viewers, statistics.viewers);
+        profiler.set_counter(ids.sent_bytes, statistics.bytes_per_second);
+        profiler.set_counter(ids.snapshot_bodies, statistics.snapshot_bodies);
+        profiler.set_counter(ids.sent_bodies, statistics.sent_bodies);
     }
 
     void handle_event(const sf::Event& event, sf::Window& window, bool& show_debug_info,